@@ -0,0 +1,169 @@
+# query_route reference test and benchmark traces, used by route.sh
+#   python3 route.py check <dir>  writes check.in, a small network with query_route -k 1 ~ 3 under both
+#                                 orders and a few bad -k, and check.ans, its answers found by brute force
+#   python3 route.py bench <dir>  writes transfer.in and route1.in ~ route3.in: the same trains and
+#                                 queries, asked as query_transfer and as query_route -k 1 ~ 3
+#
+# The brute force enumerates every journey of 2 ~ k + 1 rides from -s to -t and keeps the best one:
+# - the first ride leaves -s on -d and does not end at -t, only the last ride ends at -t;
+# - every later ride boards the station the previous one ended at, on the first day of its train
+#   leaving there no earlier than the arrival, and is not the train of the previous ride;
+# - journeys are ordered by time and cost (or cost and time), then fewer rides, then the trainIDs
+#   of the rides, then the stations where the rides end (as indexes into their trains).
+# No tickets are sold, so every ride has seatNum seats.
+import os, random, sys
+
+MONTHS = [(6, 30), (7, 31), (8, 31), (9, 30), (10, 31), (11, 30), (12, 31)]
+
+
+def date(d):  # d = day offset from 06-01
+    for mm, n in MONTHS:
+        if d < n:
+            return "%02d-%02d" % (mm, d + 1)
+        d -= n
+
+
+def when(t):  # t = minutes from 06-01 00:00
+    return "%s %02d:%02d" % (date(t // 1440), t % 1440 // 60, t % 60)
+
+
+class Trace:
+    def __init__(self):
+        self.lines = []
+
+    def cmd(self, s):
+        self.lines.append("[%d] %s" % (len(self.lines) + 1, s))
+        return len(self.lines)
+
+
+# coarse: prices, times and starts from a few round values, so that many journeys tie
+def make_trains(trace, count, stations, max_stops, first_day, last_day, max_days, coarse=False):
+    trains = []
+    for i in range(count):
+        n = random.randint(2, max_stops)
+        route = random.sample(stations, n)
+        if coarse:
+            prices = [random.choice([10, 20]) for _ in range(n - 1)]
+            travel = [random.choice([60, 120, 180]) for _ in range(n - 1)]
+            stopover = [10] * (n - 2)
+            start = random.choice([6, 12, 18]) * 60
+        else:
+            prices = [random.randint(1, 100) for _ in range(n - 1)]
+            travel = [random.randint(10, 600) for _ in range(n - 1)]
+            stopover = [random.randint(1, 20) for _ in range(n - 2)]
+            start = random.randint(0, 1439)
+        beg = random.randint(first_day, last_day)
+        end = min(last_day + max_days, beg + random.randint(0, max_days))
+        seats = random.randint(20, 200)
+        tid = ("C%04d" if coarse else "T%04d") % i
+        trace.cmd("add_train -i %s -n %d -m %d -s %s -p %s -x %02d:%02d -t %s -o %s -d %s|%s -y G" % (
+            tid, n, seats, "|".join(route), "|".join(map(str, prices)), start // 60, start % 60,
+            "|".join(map(str, travel)), "|".join(map(str, stopover)) if n > 2 else "_", date(beg), date(end)))
+        trace.cmd("release_train -i %s" % tid)
+        # arrive[j], leave[j]: minutes from the midnight of the day the train leaves its first station
+        arrive, leave, price = [0] * n, [0] * n, [0] * n
+        leave[0] = start
+        for j in range(1, n):
+            arrive[j] = leave[j - 1] + travel[j - 1]
+            leave[j] = arrive[j] + (stopover[j - 1] if j < n - 1 else 0)
+            price[j] = price[j - 1] + prices[j - 1]
+        trains.append(dict(id=tid, stations=route, arrive=arrive, leave=leave, price=price, beg=beg, end=end,
+                           seats=seats, pos={x: j for j, x in enumerate(route)}))
+    return trains
+
+
+def brute_force(trains, s, t, d, by_cost, k):
+    through = {}
+    for train in trains:
+        for x in train["stations"][:-1]:
+            through.setdefault(x, []).append(train)
+    best = [None, None]  # key, rides
+
+    def primary(times, cost):
+        return cost if by_cost else times
+
+    def ride(station, time, dep, cost, rides, prev):
+        for train in through.get(station, []):
+            if train is prev:
+                continue
+            i = train["pos"][station]
+            if not rides:  # leaves -s on -d
+                day = (d * 1440 + 1439 - train["leave"][i]) // 1440
+                if day < train["beg"] or train["end"] < day:
+                    continue
+            else:  # the first day leaving no earlier than time
+                day = -((train["leave"][i] - time) // 1440)
+                if day > train["end"]:
+                    continue
+                day = max(day, train["beg"])
+            leaving = day * 1440 + train["leave"][i]
+            for j in range(i + 1, len(train["stations"])):
+                x = train["stations"][j]
+                if not rides and x == t:
+                    continue
+                arriving = day * 1440 + train["arrive"][j]
+                price = train["price"][j] - train["price"][i]
+                start = leaving if not rides else dep
+                legs = rides + [(train, station, leaving, x, arriving, price, j)]
+                times, total = arriving - start, cost + price
+                if best[0] is not None and primary(times, total) > best[0][0]:
+                    continue  # rides only add time and cost
+                if x == t:
+                    key = ((total, times) if by_cost else (times, total)) + (
+                        len(legs), tuple(leg[0]["id"] for leg in legs), tuple(leg[6] for leg in legs))
+                    if best[0] is None or key < best[0]:
+                        best[0], best[1] = key, legs
+                elif len(legs) < k + 1:
+                    ride(x, arriving, start, total, legs, train)
+
+    ride(s, None, None, 0, [], None)
+    if best[1] is None:
+        return ["0"]
+    return ["%s %s %s -> %s %s %d %d" % (train["id"], a, when(leaving), b, when(arriving), price, train["seats"])
+            for train, a, leaving, b, arriving, price, j in best[1]]
+
+
+def check(out_dir):
+    random.seed(2024)
+    trace = Trace()
+    stations = ["S%d" % i for i in range(10)]
+    trains = make_trains(trace, 30, stations, 6, 0, 12, 8) + make_trains(trace, 30, stations, 6, 0, 12, 8, True)
+    answers = ["[%d] 0" % (i + 1) for i in range(len(trace.lines))]  # add_train and release_train
+    for q in range(600):
+        s, t = random.sample(stations, 2)
+        d = random.randint(0, 20)
+        by_cost = random.random() < 0.5
+        k = q % 3 + 1
+        ts = trace.cmd("query_route -s %s -t %s -d %s -p %s%s" % (
+            s, t, date(d), "cost" if by_cost else "time", "" if k == 1 and q % 2 else " -k %d" % k))
+        res = brute_force(trains, s, t, d, by_cost, k)
+        answers.append("[%d] %s" % (ts, res[0]))
+        answers.extend(res[1:])
+    for k in ["0", "-1", "4", "10", "x", "1x"]:  # -k outside 1 ~ 3 fails
+        answers.append("[%d] -1" % trace.cmd("query_route -s S0 -t S1 -d 06-01 -k %s" % k))
+    answers.append("[%d] bye" % trace.cmd("exit"))
+    with open(os.path.join(out_dir, "check.in"), "w") as f:
+        f.write("\n".join(trace.lines) + "\n")
+    with open(os.path.join(out_dir, "check.ans"), "w") as f:
+        f.write("\n".join(answers) + "\n")
+
+
+def bench(out_dir):
+    random.seed(2025)
+    trace = Trace()
+    stations = ["S%02d" % i for i in range(40)]
+    make_trains(trace, 1500, stations, 25, 0, 80, 20)
+    queries = []
+    for q in range(1000):
+        s, t = random.sample(stations, 2)
+        queries.append("-s %s -t %s -d %s -p %s" % (s, t, date(random.randint(0, 90)), random.choice(["time", "cost"])))
+    for name, command in [("transfer", "query_transfer"), ("route1", "query_route -k 1"),
+                          ("route2", "query_route -k 2"), ("route3", "query_route -k 3")]:
+        lines = trace.lines + ["[%d] %s %s" % (len(trace.lines) + 1 + i, command, q) for i, q in enumerate(queries)]
+        lines.append("[%d] exit" % (len(lines) + 1))
+        with open(os.path.join(out_dir, name + ".in"), "w") as f:
+            f.write("\n".join(lines) + "\n")
+
+
+if __name__ == "__main__":
+    {"check": check, "bench": bench}[sys.argv[1]](sys.argv[2])
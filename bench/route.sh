@@ -0,0 +1,32 @@
+#!/usr/bin/bash
+# route.sh: pins query_route against a brute force and compares it with query_transfer,
+# run from the repository root: bash bench/route.sh
+# 1. 600 query_route with -k 1 ~ 3 and a few bad -k on a small network, checked against the brute force
+#    of route.py
+# 2. 1000 queries on 1500 trains, asked as query_transfer and as query_route -k 1 ~ 3: prints the time
+#    of each, and checks that query_route -k 1 gives the output of query_transfer
+
+root=$(pwd)
+work=$(mktemp -d)
+python3 bench/route.py check $work || exit 1
+python3 bench/route.py bench $work || exit 1
+
+echo "compiling"
+g++ -std=c++20 -O3 -I src/include src/main.cpp -o $work/code.out -lpthread || exit 1
+echo "compiled"
+
+mkdir $work/check && cd $work/check
+$work/code.out < $work/check.in > check.txt 2> /dev/null
+diff -q check.txt $work/check.ans > /dev/null && echo "check: same as the brute force" || echo "check: differs from the brute force"
+cd $root
+
+for name in transfer route1 route2 route3
+do
+    mkdir $work/$name && cd $work/$name
+    $work/code.out < $work/$name.in > $name.txt 2> err.txt
+    echo "$name:" $(grep "^query_transfer took\|^query_route took" err.txt | grep -v " 0.000000 ")
+    cd $root
+done
+
+diff -q $work/transfer/transfer.txt $work/route1/route1.txt > /dev/null && echo "query_route -k 1 gives the output of query_transfer" || echo "query_route -k 1 differs from query_transfer"
+rm -rf $work
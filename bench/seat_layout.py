@@ -0,0 +1,53 @@
+# generates the trace of seat_layout.sh into the directory argv[1]:
+# load.in  3000 released trains (5-30 stops over 60 stations), 60000 buy_ticket
+# query.in 20000 query_ticket, meant for a fresh process (cold seat cache)
+import os, random, sys
+
+random.seed(7)
+out_dir = sys.argv[1]
+stations = ["S%02d" % i for i in range(60)]
+ts = [0]
+
+
+def cmd(s):
+    ts[0] += 1
+    return "[%d] %s" % (ts[0], s)
+
+
+def date(d):  # d = day offset from 06-01
+    for mm, n in [(6, 30), (7, 31), (8, 31)]:
+        if d < n:
+            return "%02d-%02d" % (mm, d + 1)
+        d -= n
+    return "08-31"
+
+
+load = [cmd("add_user -c x -u u0 -p pw0 -n N0 -m m0@x -g 10"), cmd("login -u u0 -p pw0")]
+trains = []
+for i in range(3000):
+    n = random.randint(5, 30)
+    r = random.sample(stations, n)
+    b = random.randint(0, 60)
+    e = min(91, b + random.randint(10, 30))
+    load.append(cmd("add_train -i T%d -n %d -m 1000 -s %s -p %s -x 08:00 -t %s -o %s -d %s|%s -y G" % (
+        i, n, "|".join(r), "|".join("10" for _ in range(n - 1)), "|".join("60" for _ in range(n - 1)),
+        "|".join("5" for _ in range(n - 2)), date(b), date(e))))
+    load.append(cmd("release_train -i T%d" % i))
+    trains.append((r, b, e))
+for k in range(60000):
+    i = random.randrange(len(trains))
+    r, b, e = trains[i]
+    x, y = sorted(random.sample(range(len(r)), 2))
+    load.append(cmd("buy_ticket -u u0 -i T%d -d %s -n 1 -f %s -t %s" % (i, date(random.randint(b, e)), r[x], r[y])))
+load.append(cmd("exit"))
+
+query = [cmd("login -u u0 -p pw0")]
+for k in range(20000):
+    s, t = random.sample(stations, 2)
+    query.append(cmd("query_ticket -s %s -t %s -d %s -p time" % (s, t, date(random.randint(10, 80)))))
+query.append(cmd("exit"))
+
+with open(os.path.join(out_dir, "load.in"), "w") as f:
+    f.write("\n".join(load) + "\n")
+with open(os.path.join(out_dir, "query.in"), "w") as f:
+    f.write("\n".join(query) + "\n")
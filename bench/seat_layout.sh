@@ -0,0 +1,28 @@
+#!/usr/bin/bash
+# seat_layout.sh: compares the append and the date-major layout of SeatsData (SEAT_DATE_MAJOR)
+# under a query_ticket heavy trace, run from the repository root: bash bench/seat_layout.sh
+# loads the trains and sales, then runs the queries in a fresh process (cold seat cache) and prints
+# the query_ticket time and seat stats of each layout; both layouts must give the same output.
+# DEBUG builds print the seat stats on exit.
+
+root=$(pwd)
+work=$(mktemp -d)
+python3 bench/seat_layout.py $work || exit 1
+
+echo "compiling"
+g++ -std=c++20 -O3 -DDEBUG -I src/include src/main.cpp -o $work/append.out -lpthread || exit 1
+g++ -std=c++20 -O3 -DDEBUG -DSEAT_DATE_MAJOR=1 -I src/include src/main.cpp -o $work/major.out -lpthread || exit 1
+echo "compiled"
+
+for layout in append major
+do
+    mkdir $work/$layout && cd $work/$layout
+    $work/$layout.out < $work/load.in > load.txt 2> /dev/null
+    $work/$layout.out < $work/query.in > query.txt 2> err.txt
+    echo "$layout:"
+    grep "^query_ticket took\|^seat rows" err.txt
+    cd $root
+done
+
+diff -q $work/append/query.txt $work/major/query.txt > /dev/null && echo "outputs are the same" || echo "outputs differ"
+rm -rf $work
@@ -0,0 +1,57 @@
+# generates the trace of user_orders.sh into the directory argv[1]:
+# run0.in ~ run3.in, one process each: 5000 users log in (the first run also adds them and 200
+# released trains), then 50000 buy_ticket of random users, with a query_order or refund_ticket
+# every 20 orders so that the buffered messages are read back
+import os, random, sys
+
+random.seed(27)
+out_dir = sys.argv[1]
+stations = ["S%02d" % i for i in range(30)]
+USERS, TRAINS, RUNS, ORDERS = 5000, 200, 4, 50000
+ts = [0]
+
+
+def cmd(s):
+    ts[0] += 1
+    return "[%d] %s" % (ts[0], s)
+
+
+def date(d):  # d = day offset from 06-01
+    for mm, n in [(6, 30), (7, 31), (8, 31)]:
+        if d < n:
+            return "%02d-%02d" % (mm, d + 1)
+        d -= n
+    return "08-31"
+
+
+trains = []
+for run in range(RUNS):
+    lines = []
+    if run == 0:
+        lines.append(cmd("add_user -c x -u u0 -p pw -n N -m m@x -g 10"))
+        lines.append(cmd("login -u u0 -p pw"))
+        for u in range(1, USERS):
+            lines.append(cmd("add_user -c u0 -u u%d -p pw -n N -m m@x -g 1" % u))
+        lines.append(cmd("logout -u u0"))
+        for i in range(TRAINS):
+            n = random.randint(5, 20)
+            r = random.sample(stations, n)
+            lines.append(cmd("add_train -i T%d -n %d -m 100000 -s %s -p %s -x 08:00 -t %s -o %s -d 06-01|08-31 -y G" % (
+                i, n, "|".join(r), "|".join("10" for _ in range(n - 1)), "|".join("60" for _ in range(n - 1)),
+                "|".join("5" for _ in range(n - 2)))))
+            lines.append(cmd("release_train -i T%d" % i))
+            trains.append(r)
+    for u in range(USERS):
+        lines.append(cmd("login -u u%d -p pw" % u))
+    for k in range(ORDERS):
+        u = random.randrange(USERS)
+        r = trains[random.randrange(TRAINS)]
+        x, y = sorted(random.sample(range(len(r)), 2))
+        lines.append(cmd("buy_ticket -u u%d -i T%d -d %s -n 1 -f %s -t %s" % (
+            u, trains.index(r), date(random.randint(0, 91)), r[x], r[y])))
+        if k % 20 == 19:
+            u = random.randrange(USERS)
+            lines.append(cmd("query_order -u u%d" % u) if k % 40 == 19 else cmd("refund_ticket -u u%d" % u))
+    lines.append(cmd("exit"))
+    with open(os.path.join(out_dir, "run%d.in" % run), "w") as f:
+        f.write("\n".join(lines) + "\n")
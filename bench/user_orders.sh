@@ -0,0 +1,29 @@
+#!/usr/bin/bash
+# user_orders.sh: leaf writes per insert of UserOrders, buffered (USER_ORDERS_BUFFER=176) against a
+# plain B+ tree (USER_ORDERS_BUFFER=0), run from the repository root: bash bench/user_orders.sh
+# 200000 buy_ticket of 5000 users over 4 processes, see user_orders.py; DEBUG builds print the
+# fill stats of each tree on exit, UserOrders counts a leaf write each time a leaf is modified
+# (once per flushed batch when buffered). Both builds must give the same output.
+
+root=$(pwd)
+work=$(mktemp -d)
+python3 bench/user_orders.py $work || exit 1
+
+echo "compiling"
+g++ -std=c++20 -O3 -DDEBUG -I src/include src/main.cpp -o $work/buffered.out -lpthread || exit 1
+g++ -std=c++20 -O3 -DDEBUG -DUSER_ORDERS_BUFFER=0 -I src/include src/main.cpp -o $work/plain.out -lpthread || exit 1
+echo "compiled"
+
+for tree in buffered plain
+do
+    mkdir $work/$tree && cd $work/$tree
+    for run in 0 1 2 3
+    do
+        $work/$tree.out < $work/run$run.in >> out.txt 2>> err.txt
+    done
+    echo "$tree:" $(grep "^UserOrders:" err.txt | awk '{w += $(NF - 5); u += $(NF - 1)} END {printf "%d leaf writes for %d updates, %.3f per update", w, u, w / u}')
+    cd $root
+done
+
+diff -q $work/buffered/out.txt $work/plain/out.txt > /dev/null && echo "outputs are the same" || echo "outputs differ"
+rm -rf $work
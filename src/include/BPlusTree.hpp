@@ -12,12 +12,30 @@
 namespace sjtu {
 
 
+// pending insert / delete messages stored in an inner node of a buffered tree, sorted by key
+template <typename Key, typename Tp, size_t N>
+struct message_buffer {
+    int count;
+    Key key[N];
+    Tp data[N];
+    bool erase[N]; // true: delete key, false: insert (or overwrite) key with data
+};
+
+template <typename Key, typename Tp>
+struct message_buffer<Key, Tp, 0> {};
+
+
 // B+ Tree database, Every Key should be unique!!
+// BUFFER_SIZE > 0 turns the tree into a write-optimized B-epsilon tree: inserts and deletes are
+// buffered as messages in the inner nodes and flushed down in batches, searches merge the buffers.
+// In that mode inner nodes are not rebalanced after deletes (leaves still are).
 template < typename Key, typename Tp,
            size_t FILE_BLOCK_SIZE = 4096,
            size_t MAX_CACHE_SIZE = 10000,
            const bool enable_file_recycle = true,
-           size_t M = (FILE_BLOCK_SIZE + sizeof(Key) - 2 * sizeof(int)) / (sizeof(Key) + sizeof(int)),
+           size_t BUFFER_SIZE = 0,
+           size_t M = (FILE_BLOCK_SIZE - (BUFFER_SIZE ? BUFFER_SIZE * (sizeof(Key) + sizeof(Tp) + 1) + 2 * sizeof(Key) : 0)
+                       + sizeof(Key) - 2 * sizeof(int)) / (sizeof(Key) + sizeof(int)),
            size_t L = (FILE_BLOCK_SIZE - sizeof(int) * 3) / (sizeof(Key) + sizeof(Tp))
            >
 class BPlusTree {
@@ -25,6 +43,10 @@ class BPlusTree {
 #define MIN_NODE_SIZE ((M + 1) / 2)
 #define MAX_LEAF_SIZE L
 #define MIN_LEAF_SIZE ((L + 1) / 2)
+// split point for inserts at the right edge of a node (keys arriving in increasing order),
+// the left node keeps 90% so that append-heavy indexes stay nearly full
+#define APPEND_NODE_SIZE (M * 9 / 10 < 2 ? 2 : M * 9 / 10)
+#define APPEND_LEAF_SIZE (L * 9 / 10 < 1 ? 1 : L * 9 / 10)
     using Data_t = Tp;
     using Key_t = Key;
     using File_t = File<3, FILE_BLOCK_SIZE>;
@@ -45,7 +67,9 @@ class BPlusTree {
     struct inner_node : node {
         Key_t key[MAX_NODE_SIZE - 1];
         int child[MAX_NODE_SIZE];
+        [[no_unique_address]] message_buffer<Key_t, Data_t, BUFFER_SIZE> buffer;
     };
+    using buffer_t = message_buffer<Key_t, Data_t, BUFFER_SIZE>;
 
     struct leaf_node : node {
         Key_t key[MAX_LEAF_SIZE];
@@ -53,6 +77,13 @@ class BPlusTree {
         int next;
     };
 
+    struct fill_stats_t {
+        size_t inner_count; // number of inner nodes
+        size_t inner_used;  // number of children in all inner nodes
+        size_t leaf_count;  // number of leaf nodes
+        size_t leaf_used;   // number of keys in all leaf nodes
+    };
+
     class BNodePtr {
         File_t *file;
         size_t *tag;
@@ -155,11 +186,14 @@ class BPlusTree {
     File_t data_file;
 
     LRUHashmap<int, BNodePtr, 2999> cache_map;
+    std::string m_name;
 
 
     // for debug
     size_t count_of_get_node = 0;
     size_t count_of_get_node_in_cache = 0;
+    size_t count_of_update = 0;     // number of insert / remove calls
+    size_t count_of_leaf_write = 0; // number of times a leaf is modified (a random leaf write without cache)
 
   public:
 
@@ -171,7 +205,7 @@ class BPlusTree {
         cache_map.clear();
     }
 
-    BPlusTree(std::string data_file_name) : data_file(data_file_name + ".db") {
+    BPlusTree(std::string data_file_name) : data_file(data_file_name + ".db"), m_name(data_file_name) {
         static_assert(sizeof(inner_node) <= FILE_BLOCK_SIZE,
                       "inner_node is too large, please use smaller M");
         static_assert(sizeof(leaf_node) <= FILE_BLOCK_SIZE,
@@ -191,6 +225,9 @@ class BPlusTree {
         data_file.write_info(m_root, 1);
         data_file.write_info(m_size, 2);
         data_file.write_info(m_recycle_head, 3);
+#ifdef DEBUG
+        print_fill_stats();
+#endif
         clear_cache();
         // std::cerr << "count_of_get_node: " << count_of_get_node << std::endl;
         // std::cerr << "count_of_get_node_in_cache: " << count_of_get_node_in_cache << std::endl;
@@ -233,6 +270,9 @@ class BPlusTree {
             p->set_index(data_file.write(), is_inner);
             cache_map.insert(p->index, p);
         }
+        if constexpr(BUFFER_SIZE > 0) {
+            if (is_inner) p.as_inner()->buffer.count = 0;
+        }
         p.set_dirty();
         return p;
     }
@@ -283,10 +323,13 @@ class BPlusTree {
             index = 0;
         } else {
             // leaf is full, split it
+            // key > all keys in leaf: right-edge insert, split asymmetrically
+            bool append = Camp(key, leaf->key[leaf->count - 1]) > 0;
+            int split = append ? APPEND_LEAF_SIZE : MIN_LEAF_SIZE;
             leaf_node *new_leaf = new_node(false).as_leaf();
             new_leaf->next = leaf->next;
             leaf->next = new_leaf->index;
-            if (Camp(key, leaf->key[MIN_LEAF_SIZE - 1]) <=
+            if (!append && Camp(key, leaf->key[MIN_LEAF_SIZE - 1]) <=
                 0) { // key <= leaf->key[MIN_LEAF_SIZE - 1]
                 // insert key to the left node (leaf)
                 // for (int i = 0; i < MAX_LEAF_SIZE + 1 - MIN_LEAF_SIZE; ++i) {
@@ -302,18 +345,19 @@ class BPlusTree {
                 insert_valdata(leaf->key, leaf->data, leaf->count, key, data);
             } else {
                 // insert key to the right node (new_leaf)
-                // for (int i = 0; i < MAX_LEAF_SIZE - MIN_LEAF_SIZE; ++i) {
-                //     new_leaf->key[i] = leaf->key[i + MIN_LEAF_SIZE];
-                //     new_leaf->data[i] = leaf->data[i + MIN_LEAF_SIZE];
+                // for (int i = 0; i < MAX_LEAF_SIZE - split; ++i) {
+                //     new_leaf->key[i] = leaf->key[i + split];
+                //     new_leaf->data[i] = leaf->data[i + split];
                 // }
-                quickcopy(new_leaf->key, leaf->key + MIN_LEAF_SIZE,
-                          MAX_LEAF_SIZE - MIN_LEAF_SIZE);
-                quickcopy(new_leaf->data, leaf->data + MIN_LEAF_SIZE,
-                          MAX_LEAF_SIZE - MIN_LEAF_SIZE);
-                leaf->count = MIN_LEAF_SIZE;
-                new_leaf->count = MAX_LEAF_SIZE  - MIN_LEAF_SIZE;
+                quickcopy(new_leaf->key, leaf->key + split,
+                          MAX_LEAF_SIZE - split);
+                quickcopy(new_leaf->data, leaf->data + split,
+                          MAX_LEAF_SIZE - split);
+                leaf->count = split;
+                new_leaf->count = MAX_LEAF_SIZE - split;
                 insert_valdata(new_leaf->key, new_leaf->data, new_leaf->count, key, data);
             }
+            ++count_of_leaf_write;
             index = new_leaf->index;
             upload_key = new_leaf->key[0];
         }
@@ -354,18 +398,21 @@ class BPlusTree {
                 new_inner->count = MAX_NODE_SIZE + 1 - MIN_NODE_SIZE;
             } else {
                 // insert key to the right node (new_inner)
-                // for (int i = 0; i < MAX_NODE_SIZE - MIN_NODE_SIZE; ++i) {
-                //     if (i != 0) new_inner->key[i - 1] = inner->key[i + MIN_NODE_SIZE - 1];
-                //     new_inner->child[i] = inner->child[i + MIN_NODE_SIZE];
+                // the new child is the last one: right-edge insert, split asymmetrically
+                int split = pos == inner->count - 1 ? APPEND_NODE_SIZE : MIN_NODE_SIZE;
+                // for (int i = 0; i < MAX_NODE_SIZE - split; ++i) {
+                //     if (i != 0) new_inner->key[i - 1] = inner->key[i + split - 1];
+                //     new_inner->child[i] = inner->child[i + split];
                 // }
-                quickcopy(new_inner->key, inner->key + MIN_NODE_SIZE, MAX_NODE_SIZE - MIN_NODE_SIZE - 1);
-                quickcopy(new_inner->child, inner->child + MIN_NODE_SIZE, MAX_NODE_SIZE - MIN_NODE_SIZE);
-                upload_key = inner->key[MIN_NODE_SIZE - 1];
-                inner->count = MIN_NODE_SIZE;
-                new_inner->count = MAX_NODE_SIZE - MIN_NODE_SIZE;
-                insert_valchild(new_inner->key, new_inner->child, pos - MIN_NODE_SIZE,
+                quickcopy(new_inner->key, inner->key + split, MAX_NODE_SIZE - split - 1);
+                quickcopy(new_inner->child, inner->child + split, MAX_NODE_SIZE - split);
+                upload_key = inner->key[split - 1];
+                inner->count = split;
+                new_inner->count = MAX_NODE_SIZE - split;
+                insert_valchild(new_inner->key, new_inner->child, pos - split,
                                 new_inner->count, key, child);
             }
+            if constexpr(BUFFER_SIZE > 0) split_buffer(inner->buffer, new_inner->buffer, upload_key);
             index = new_inner->index;
             // upload_key = new_inner->key[0];
         }
@@ -554,10 +601,10 @@ class BPlusTree {
     }
 
     void print_node(int cur_index) {
-        node *cur = get_node(cur_index);
+        BNodePtr cur = get_node(cur_index);
         if (cur->is_inner()) {
             // if (cur_index != m_root) assert(cur->count >= MIN_NODE_SIZE);
-            inner_node &x = *static_cast<inner_node *>(cur);
+            inner_node &x = *cur.as_inner();
             std::cerr << "inner{ " << x.index << ", " << x.count << ": " << x.child[0] <<
                       " ";
             for (int i = 1; i < x.count; ++i) {
@@ -569,7 +616,7 @@ class BPlusTree {
             }
         } else {
             // if (cur_index != m_root) assert(cur->count >= MIN_LEAF_SIZE);
-            leaf_node &x = *static_cast<leaf_node *>(cur);
+            leaf_node &x = *cur.as_leaf();
             std::cerr << "leaf{ " << x.index << ", " << x.count << ": ";
             for (int i = 0; i < x.count; ++i) {
                 std::cerr << "[" << x.key[i] << "] " << x.data[i] << " ";
@@ -578,8 +625,267 @@ class BPlusTree {
         }
     }
 
+    void fill_stats(int cur_index, fill_stats_t &res) {
+        BNodePtr cur = get_node(cur_index);
+        if (cur->is_inner()) {
+            ++res.inner_count;
+            res.inner_used += cur->count;
+            for (int i = 0; i < cur->count; ++i) {
+                fill_stats(cur.as_inner()->child[i], res);
+            }
+        } else {
+            ++res.leaf_count;
+            res.leaf_used += cur->count;
+        }
+    }
+
+    // index of the child of inner which covers key
+    int route(inner_node *inner, const Key_t &key) {
+        int i = 0;
+        while (i < inner->count - 1 && Camp(inner->key[i], key) <= 0) ++i;
+        return i;
+    }
+
+    // position of the first message whose key >= key
+    int buffer_lower_bound(const buffer_t &buf, const Key_t &key) {
+        int l = 0, r = buf.count;
+        while (l < r) {
+            int mid = (l + r) / 2;
+            if (Camp(buf.key[mid], key) < 0) l = mid + 1;
+            else r = mid;
+        }
+        return l;
+    }
+
+    // put a message into the buffer, it replaces the older message with the same key
+    void buffer_put(buffer_t &buf, const Key_t &key, const Data_t &data, bool erase) {
+        int pos = buffer_lower_bound(buf, key);
+        if (pos == buf.count || Camp(buf.key[pos], key) != 0) {
+            quickcopy(buf.key + pos + 1, buf.key + pos, buf.count - pos);
+            quickcopy(buf.data + pos + 1, buf.data + pos, buf.count - pos);
+            quickcopy(buf.erase + pos + 1, buf.erase + pos, buf.count - pos);
+            ++buf.count;
+        }
+        buf.key[pos] = key;
+        buf.data[pos] = data;
+        buf.erase[pos] = erase;
+    }
+
+    // remove the messages [l, r) from the buffer
+    void buffer_erase(buffer_t &buf, int l, int r) {
+        quickcopy(buf.key + l, buf.key + r, buf.count - r);
+        quickcopy(buf.data + l, buf.data + r, buf.count - r);
+        quickcopy(buf.erase + l, buf.erase + r, buf.count - r);
+        buf.count -= r - l;
+    }
+
+    // inner node is split at upload_key, move the messages >= upload_key to the new right node
+    void split_buffer(buffer_t &left, buffer_t &right, const Key_t &upload_key) {
+        int pos = buffer_lower_bound(left, upload_key);
+        right.count = left.count - pos;
+        quickcopy(right.key, left.key + pos, right.count);
+        quickcopy(right.data, left.data + pos, right.count);
+        quickcopy(right.erase, left.erase + pos, right.count);
+        left.count = pos;
+    }
+
+    // apply a message to the leaf level directly, buffers on the path are skipped (they hold newer messages)
+    // leaves are merged or borrowed when they underflow, inner nodes are not
+    void apply_message(const Key_t &key, const Data_t &data, bool erase) {
+        pair<BNodePtr, int>
+        path[40]; // path from root to leaf <index, pos>, 40 is enough
+        int path_top = -1;
+        if (m_root == 0) {
+            if (erase) return;
+            leaf_node *cur = new_node(false).as_leaf();
+            m_root = cur->index;
+            ++m_size;
+            cur->count = 1;
+            cur->key[0] = key;
+            cur->data[0] = data;
+            cur->next = 0;
+            return;
+        }
+        BNodePtr cur = get_node(m_root);
+        while (cur->is_inner()) {
+            int i = route(cur.as_inner(), key);
+            path[++path_top] = {cur, i};
+            cur = get_node(cur.as_inner()->child[i]);
+        }
+        cur.set_dirty();
+        leaf_node *leaf = cur.as_leaf();
+        int i = 0;
+        while (i < leaf->count && Camp(leaf->key[i], key) < 0) ++i;
+        bool found = i < leaf->count && Camp(leaf->key[i], key) == 0;
+        if (erase) {
+            if (!found) return;
+            quickcopy(leaf->key + i, leaf->key + i + 1, leaf->count - i - 1);
+            quickcopy(leaf->data + i, leaf->data + i + 1, leaf->count - i - 1);
+            --leaf->count;
+            --m_size;
+            if (leaf->count < MIN_LEAF_SIZE) {
+                if (path_top == -1) {
+                    if (leaf->count == 0) {
+                        remove_node(leaf);
+                        m_root = 0;
+                    }
+                } else if (path[path_top].first->count > 1) {
+                    path[path_top].first.set_dirty();
+                    leaf_merge_or_borrow(leaf, path[path_top].first.as_inner(), path[path_top].second);
+                }
+            }
+            return;
+        }
+        if (found) {
+            leaf->data[i] = data;
+            return;
+        }
+        ++m_size;
+        int index; Key_t upload_key;
+        leaf_node_insert(leaf, key, data, index, upload_key);
+        while (path_top != -1 && index != 0) {
+            auto kkey = upload_key;
+            auto cchild = index;
+            path[path_top].first.set_dirty();
+            inner_node_insert(path[path_top].first.as_inner(),
+                              path[path_top].second, kkey, cchild, index,
+                              upload_key);
+            --path_top;
+        }
+        if (index != 0) { // create new root
+            inner_node *new_root = new_node(true).as_inner();
+            new_root->count = 2;
+            new_root->key[0] = upload_key;
+            new_root->child[0] = m_root;
+            new_root->child[1] = index;
+            m_root = new_root->index;
+        }
+    }
+
+    // push the messages of the child with most pending messages one level down
+    void flush(BNodePtr &cur) {
+        inner_node *inner = cur.as_inner();
+        buffer_t &buf = inner->buffer;
+        int pos = 0, l = 0, r = 0;
+        for (int i = 0, j = 0; i < inner->count; ++i) {
+            int k = j;
+            while (j < buf.count && (i == inner->count - 1 || Camp(buf.key[j], inner->key[i]) < 0)) ++j;
+            if (j - k > r - l) pos = i, l = k, r = j;
+        }
+        BNodePtr child = get_node(inner->child[pos]);
+        if (child->is_inner()) {
+            buffer_t &child_buf = child.as_inner()->buffer;
+            if (child_buf.count + (r - l) > BUFFER_SIZE) {
+                flush(child); // make room in the child first, the caller will try again
+                return;
+            }
+            child.set_dirty();
+            for (int i = l; i < r; ++i) {
+                buffer_put(child_buf, buf.key[i], buf.data[i], buf.erase[i]);
+            }
+            cur.set_dirty();
+            buffer_erase(buf, l, r);
+        } else {
+            // the batch may split cur, so take it out of the buffer first
+            Key_t keys[BUFFER_SIZE];
+            Data_t datas[BUFFER_SIZE];
+            bool erases[BUFFER_SIZE];
+            int n = r - l;
+            quickcopy(keys, buf.key + l, n);
+            quickcopy(datas, buf.data + l, n);
+            quickcopy(erases, buf.erase + l, n);
+            cur.set_dirty();
+            buffer_erase(buf, l, r);
+            ++count_of_leaf_write; // the whole batch goes to one leaf
+            child = BNodePtr(); // the leaf may be merged away and its block recycled by the batch
+            for (int i = 0; i < n; ++i) {
+                apply_message(keys[i], datas[i], erases[i]);
+            }
+        }
+    }
+
+    void put_message(const Key_t &key, const Data_t &data, bool erase) {
+        ++count_of_update;
+        if (m_root == 0 || !get_node(m_root)->is_inner()) {
+            ++count_of_leaf_write;
+            apply_message(key, data, erase);
+            return;
+        }
+        BNodePtr root = get_node(m_root);
+        root.set_dirty();
+        buffer_put(root.as_inner()->buffer, key, data, erase);
+        while (root.as_inner()->buffer.count >= BUFFER_SIZE) flush(root);
+        // leaves merged under the root may leave it with a single child
+        while (true) {
+            BNodePtr cur = get_node(m_root);
+            if (!cur->is_inner() || cur->count > 1 || cur.as_inner()->buffer.count > 0) break;
+            cur.set_dirty();
+            m_root = cur.as_inner()->child[0];
+            remove_node(cur.as_inner());
+        }
+    }
+
+    struct message_t {
+        Key_t key;
+        Data_t data;
+        bool erase;
+        int depth; // smaller depth is newer
+    };
+
+    // collect the leaf entries and the buffered messages in [key_L, key_R] of the subtree
+    void collect(int cur_index, int depth, const Key_t &key_L, const Key_t &key_R,
+                 vector<pair<Key_t, Data_t>> &entries, vector<message_t> &messages) {
+        BNodePtr cur = get_node(cur_index);
+        if (cur->is_inner()) {
+            inner_node *inner = cur.as_inner();
+            const buffer_t &buf = inner->buffer;
+            for (int i = buffer_lower_bound(buf, key_L); i < buf.count && Camp(buf.key[i], key_R) <= 0; ++i) {
+                messages.push_back({buf.key[i], buf.data[i], buf.erase[i], depth});
+            }
+            for (int i = 0; i < inner->count; ++i) { // child i covers [key[i - 1], key[i])
+                if (i > 0 && Camp(inner->key[i - 1], key_R) > 0) break;
+                if (i < inner->count - 1 && Camp(inner->key[i], key_L) <= 0) continue;
+                collect(inner->child[i], depth + 1, key_L, key_R, entries, messages);
+            }
+        } else {
+            leaf_node *leaf = cur.as_leaf();
+            for (int i = 0; i < leaf->count; ++i) {
+                if (Camp(leaf->key[i], key_L) >= 0 && Camp(leaf->key[i], key_R) <= 0) {
+                    entries.push_back({leaf->key[i], leaf->data[i]});
+                }
+            }
+        }
+    }
+
+    void buffered_search(const Key_t &key_L, const Key_t &key_R, vector<Data_t> &res) {
+        if (m_root == 0) return;
+        vector<pair<Key_t, Data_t>> entries;
+        vector<message_t> messages;
+        collect(m_root, 0, key_L, key_R, entries, messages);
+        sort(messages.begin(), messages.end(), [](const message_t &a, const message_t &b) {
+            int c = Camp(a.key, b.key);
+            return c != 0 ? c < 0 : a.depth < b.depth;
+        });
+        size_t j = 0;
+        for (size_t i = 0; i < messages.size(); ++i) {
+            if (i > 0 && Camp(messages[i].key, messages[i - 1].key) == 0) continue; // older message
+            while (j < entries.size() && Camp(entries[j].first, messages[i].key) < 0) {
+                res.push_back(entries[j++].second);
+            }
+            if (j < entries.size() && Camp(entries[j].first, messages[i].key) == 0) ++j;
+            if (!messages[i].erase) res.push_back(messages[i].data);
+        }
+        while (j < entries.size()) res.push_back(entries[j++].second);
+    }
+
   public:
     void insert(const Key_t &key, const Data_t &data) {
+        if constexpr(BUFFER_SIZE > 0) {
+            put_message(key, data, false);
+            return;
+        }
+        ++count_of_update;
+        ++count_of_leaf_write;
         pair<BNodePtr, int>
         path[40]; // path from root to leaf <index, pos>, 40 is enough
         int path_top;
@@ -628,6 +934,10 @@ class BPlusTree {
     }
 
     void search(const Key_t &key_L, const Key_t &key_R, vector<Data_t> &res) {
+        if constexpr(BUFFER_SIZE > 0) {
+            buffered_search(key_L, key_R, res);
+            return;
+        }
         if (m_size == 0) return;
         BNodePtr cur = get_node(m_root);
         while (cur->is_inner()) {
@@ -666,6 +976,10 @@ class BPlusTree {
 
 
     void modify(const Key_t &key, const Data_t &data) {
+        if constexpr(BUFFER_SIZE > 0) {
+            if (find(key).second) put_message(key, data, false);
+            return;
+        }
         if (m_size == 0) return;
         BNodePtr cur = get_node(m_root);
         while (cur->is_inner()) {
@@ -697,10 +1011,16 @@ class BPlusTree {
     }
 
     void remove(const Key_t &key) {
+        if constexpr(BUFFER_SIZE > 0) {
+            put_message(key, Data_t(), true);
+            return;
+        }
         pair<BNodePtr, int>
         path[40]; // path from root to leaf <index, pos>, 40 is enough
         int path_top;
         if (m_size == 0) return;
+        ++count_of_update;
+        ++count_of_leaf_write;
         path_top = -1;
         BNodePtr cur = get_node(m_root);
         while (cur->is_inner()) {
@@ -772,7 +1092,7 @@ class BPlusTree {
     }
 
     void clear() {
-        if (m_size == 0) return;
+        if (m_root == 0) return;
         m_size = 0;
         m_root = 0;
         m_recycle_head = 0;
@@ -782,6 +1102,23 @@ class BPlusTree {
 
 
 
+    // walk the whole tree and count the occupancy of the nodes (for debug, it reads every node)
+    fill_stats_t fill_stats() {
+        fill_stats_t res{0, 0, 0, 0};
+        if (m_root) fill_stats(m_root, res);
+        return res;
+    }
+
+    void print_fill_stats() {
+        fill_stats_t res = fill_stats();
+        std::cerr << m_name << ": " << m_size << " keys, "
+                  << res.leaf_count << " leaves (" << (res.leaf_count ? res.leaf_used * 100.0 /
+                          (res.leaf_count * MAX_LEAF_SIZE) : 0) << "% full), "
+                  << res.inner_count << " inner nodes (" << (res.inner_count ? res.inner_used * 100.0 /
+                          (res.inner_count * MAX_NODE_SIZE) : 0) << "% full), "
+                  << count_of_leaf_write << " leaf writes for " << count_of_update << " updates" << std::endl;
+    }
+
     void debug() {
         std::cerr << "Tree size: " << m_size << std::endl;
         if (m_root) print_node(m_root);
@@ -801,6 +1138,8 @@ class BPlusTree {
 #undef MIN_NODE_SIZE
 #undef MAX_LEAF_SIZE
 #undef MIN_LEAF_SIZE
+#undef APPEND_NODE_SIZE
+#undef APPEND_LEAF_SIZE
 
 template < typename Key, typename Tp,
            size_t FILE_BLOCK_SIZE = 4096,
@@ -0,0 +1,138 @@
+/**
+ * @file BloomFilter.hpp
+ * @brief Blocked Bloom filter persisted in a side file
+ *
+ */
+
+#ifndef BLOOMFILTER_HPP
+#define BLOOMFILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include "utility.hpp"
+#include "Vector.hpp"
+
+namespace sjtu {
+
+/**
+ * @brief A blocked Bloom filter for answering "definitely not present" without touching the disk.
+ *
+ * Every key sets its bits inside a single 64-bit word, so a query costs one memory access.
+ * The filter cannot delete keys, the owner is expected to call reset() and re-insert every key
+ * (a rebuild) when the filter is over capacity or too many keys have been removed.
+ *
+ * The filter is loaded from `path` in the constructor and written back in the destructor.
+ *
+ * @tparam Key The key type.
+ * @tparam BITS_PER_KEY Number of filter bits reserved for each key (0 disables the filter).
+ * @tparam Hash The hash function type.
+ */
+template <class Key, size_t BITS_PER_KEY, class Hash = std::hash<Key>>
+class BloomFilter {
+  private:
+    static constexpr int HASH_COUNT = BITS_PER_KEY * 69 / 100 < 1 ? 1 :
+                                      (BITS_PER_KEY * 69 / 100 > 8 ? 8 : BITS_PER_KEY * 69 / 100);
+    static constexpr size_t MIN_CAPACITY = 1024;
+
+    std::string file_name;
+    vector<uint64_t> m_bits; ///< size is a power of two
+    size_t m_capacity;       ///< number of keys the filter is sized for
+    size_t m_count;          ///< number of keys inserted since the last reset
+    size_t m_owner_size;     ///< size of the owner when the filter was saved, to detect a stale file
+    bool m_loaded;
+
+  public:
+    BloomFilter(const std::string &path) : file_name(path + ".bloom"), m_capacity(0), m_count(0),
+        m_owner_size(0), m_loaded(false) {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.good()) return;
+        size_t words = 0;
+        file.read(reinterpret_cast<char *>(&m_capacity), sizeof(size_t));
+        file.read(reinterpret_cast<char *>(&m_count), sizeof(size_t));
+        file.read(reinterpret_cast<char *>(&m_owner_size), sizeof(size_t));
+        file.read(reinterpret_cast<char *>(&words), sizeof(size_t));
+        if (!file.good() || words == 0 || (words & (words - 1))) return;
+        m_bits.resize(words);
+        file.read(reinterpret_cast<char *>(m_bits.data()), words * sizeof(uint64_t));
+        m_loaded = file.good();
+    }
+
+    ~BloomFilter() {
+        if (!m_loaded) return;
+        std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+        size_t words = m_bits.size();
+        file.write(reinterpret_cast<const char *>(&m_capacity), sizeof(size_t));
+        file.write(reinterpret_cast<const char *>(&m_count), sizeof(size_t));
+        file.write(reinterpret_cast<const char *>(&m_owner_size), sizeof(size_t));
+        file.write(reinterpret_cast<const char *>(&words), sizeof(size_t));
+        file.write(reinterpret_cast<const char *>(m_bits.data()), words * sizeof(uint64_t));
+    }
+
+    /**
+     * @brief Clears the filter and sizes it for at least `capacity` keys.
+     */
+    void reset(size_t capacity) {
+        if (capacity < MIN_CAPACITY) capacity = MIN_CAPACITY;
+        size_t words = 1;
+        while (words * 64 < capacity * BITS_PER_KEY) words <<= 1;
+        m_bits.clear();
+        m_bits.resize(words, 0);
+        m_capacity = capacity;
+        m_count = 0;
+        m_loaded = true;
+    }
+
+    void insert(const Key &key) {
+        uint64_t h = hash_mix(Hash()(key)), g = h * 0x9e3779b97f4a7c15ULL;
+        uint64_t &word = m_bits[h & (m_bits.size() - 1)];
+        for (int i = 0; i < HASH_COUNT; ++i) word |= 1ULL << (g >> (58 - 6 * i) & 63);
+        ++m_count;
+    }
+
+    /**
+     * @brief Returns false only if the key was never inserted since the last reset.
+     */
+    bool may_contain(const Key &key) const {
+        uint64_t h = hash_mix(Hash()(key)), g = h * 0x9e3779b97f4a7c15ULL;
+        uint64_t word = m_bits[h & (m_bits.size() - 1)];
+        for (int i = 0; i < HASH_COUNT; ++i) {
+            if (!(word >> (g >> (58 - 6 * i) & 63) & 1)) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Whether a usable filter was loaded (or built by reset()) for an owner of the given size.
+     */
+    bool valid(size_t owner_size) const {
+        return m_loaded && m_owner_size == owner_size;
+    }
+
+    void set_owner_size(size_t owner_size) {
+        m_owner_size = owner_size;
+    }
+
+    /**
+     * @brief Whether the filter should be rebuilt: it is over capacity, or most of its keys were removed.
+     */
+    bool need_rebuild(size_t owner_size) const {
+        return m_count > m_capacity || m_count > 2 * owner_size + MIN_CAPACITY;
+    }
+
+    size_t capacity() const {
+        return m_capacity;
+    }
+};
+
+template <class Key, class Hash>
+class BloomFilter<Key, 0, Hash> {
+  public:
+    BloomFilter(const std::string &) {}
+};
+
+} // namespace sjtu
+
+#endif // BLOOMFILTER_HPP
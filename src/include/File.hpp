@@ -114,6 +114,13 @@ class File {
         file.read(infobuffer, info_len * sizeof(int));
     }
 
+    /**
+     * @brief Flushes buffered writes, so that other streams opened on the file see them.
+     */
+    void flush() {
+        file.flush();
+    }
+
     /**
      * @brief Retrieves the value of the nth integer in the information buffer.
      *
@@ -236,6 +243,28 @@ class DataFile : public File<0, BLOCK_SIZE> {
 };
 
 
+/**
+ * @brief A read-only stream on a DataFile.
+ *
+ * Every reader has its own stream, so several threads can read the same DataFile at once
+ * (one reader per thread). Call flush() on the DataFile after writing and before reading.
+ */
+template < class Tp, size_t BLOCK_SIZE = (sizeof(Tp) + 4095) / 4096 * 4096 >
+class DataFileReader {
+  private:
+    std::ifstream file;
+  public:
+    void open(const std::string &file_name) {
+        file.open(file_name + ".dat", std::ios::in | std::ios::binary);
+    }
+    void read(Tp &t, const int index, size_t offset = 0, size_t size = sizeof(Tp)) {
+        file.clear();
+        file.seekg(index * BLOCK_SIZE + offset);
+        file.read(reinterpret_cast<char *>(&t) + offset, size);
+    }
+};
+
+
 template<class Tp>
 class VectorFile : public vector<Tp> {
   private:
@@ -290,6 +319,7 @@ class HashMapFile : public Hashmap<Key, Tp, MOD> {
             vector<Data_t> tmp;
             tmp.resize(count);
             file.read(reinterpret_cast<char *>(tmp.data()), count * sizeof(Data_t));
+            this->reserve(count);
             for (const auto &i : tmp) {
                 this->insert(i);
             }
@@ -298,13 +328,9 @@ class HashMapFile : public Hashmap<Key, Tp, MOD> {
     ~HashMapFile() {
         vector<Data_t> tmp;
         tmp.reserve(this->size());
-        for (size_t i = 0; i < MOD; ++i) {
-            auto p = HashMap::m_data[i];
-            while (p) {
-                tmp.push_back(p->data);
-                p = p->next;
-            }
-        }
+        this->for_each([&tmp](const Key &key, const Tp &value) {
+            tmp.push_back(Data_t(key, value));
+        });
         size_t count = tmp.size();
         file.seekp(0);
         file.write(reinterpret_cast<const char *>(&count), sizeof(size_t));
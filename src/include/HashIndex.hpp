@@ -0,0 +1,325 @@
+/**
+ * @file HashIndex.hpp
+ * @brief On-disk extendible hash index for point-only keys
+ *
+ */
+
+#ifndef HASHINDEX_HPP
+#define HASHINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <string>
+#include "utility.hpp"
+#include "File.hpp"
+#include "Vector.hpp"
+#include "Hashmap.hpp"
+#include "BloomFilter.hpp"
+
+namespace sjtu {
+
+/**
+ * @brief An extendible hash index stored in bucket pages of a File, for keys that are only
+ * looked up by equality (never range-scanned).
+ *
+ * Every lookup reads exactly one bucket page (through an LRU page cache), nothing is loaded
+ * at startup except the directory, and dirty pages are written back when they leave the cache.
+ * Buckets split (doubling the directory when needed) when full; removed keys leave free slots
+ * behind, buckets are never merged.
+ *
+ * Files: <name>.idx (bucket pages), <name>.dir (directory, written on exit),
+ * <name>.bloom (only with BLOOM_BITS_PER_KEY > 0).
+ *
+ * @tparam Key The key type, every key should be unique.
+ * @tparam Tp The value type.
+ * @tparam FILE_BLOCK_SIZE The size of a bucket page.
+ * @tparam MAX_CACHE_SIZE The number of pages kept in memory.
+ * @tparam BLOOM_BITS_PER_KEY Bloom filter bits per key (0: no filter).
+ * @tparam Hash The hash function type.
+ */
+template < class Key, class Tp,
+           size_t FILE_BLOCK_SIZE = 4096,
+           size_t MAX_CACHE_SIZE = 1000,
+           size_t BLOOM_BITS_PER_KEY = 0,
+           class Hash = std::hash<Key>
+           >
+class HashIndex {
+    using File_t = File<2, FILE_BLOCK_SIZE>;
+    static constexpr int CAPACITY = (FILE_BLOCK_SIZE - 2 * sizeof(int)) / (sizeof(Key) + sizeof(Tp));
+    static constexpr int MAX_DEPTH = 30;
+
+    struct bucket {
+        int depth; // local depth: all keys in the bucket share the low `depth` bits of their hash
+        int count;
+        Key key[CAPACITY];
+        Tp data[CAPACITY];
+    };
+
+    struct page_t {
+        bucket *ptr = nullptr;
+        bool dirty = false;
+    };
+
+    File_t data_file; // info: 1 global depth, 2 size
+    std::string dir_file_name;
+    vector<int> m_dir; // hash & (2^depth - 1) -> page index, size 2^depth
+    int m_depth;
+    int m_size;
+    LRUHashmap<int, page_t, 1999> cache_map;
+    BloomFilter<Key, BLOOM_BITS_PER_KEY> m_filter;
+
+    // for debug
+    size_t count_of_page_read = 0;
+    size_t count_of_page_write = 0;
+    size_t count_of_filter_skip = 0;
+
+    static uint64_t hash(const Key &key) {
+        return hash_mix(Hash()(key));
+    }
+
+    void write_back(page_t &page, int index) {
+        if (page.dirty) {
+            data_file.update(*page.ptr, index);
+            ++count_of_page_write;
+        }
+        delete page.ptr;
+        page.ptr = nullptr;
+    }
+
+    void shrink_cache() {
+        while (cache_map.size() >= MAX_CACHE_SIZE) {
+            auto &p = cache_map.back();
+            write_back(p.second, p.first);
+            cache_map.pop_back();
+        }
+    }
+
+    void clear_cache() {
+        while (!cache_map.empty()) {
+            auto &p = cache_map.back();
+            write_back(p.second, p.first);
+            cache_map.pop_back();
+        }
+    }
+
+    // the returned page stays valid until the next get_page / new_page call evicts it,
+    // callers use at most two pages at once
+    page_t &get_page(int index) {
+        if (!cache_map.check(index)) {
+            shrink_cache();
+            page_t &page = cache_map.at(index);
+            page.ptr = new bucket;
+            data_file.read(*page.ptr, index);
+            ++count_of_page_read;
+            return page;
+        }
+        return cache_map.at(index);
+    }
+
+    page_t &new_page(int depth, int &index) {
+        shrink_cache();
+        index = data_file.write();
+        page_t &page = cache_map.at(index);
+        page.ptr = new bucket;
+        page.ptr->depth = depth;
+        page.ptr->count = 0;
+        page.dirty = true;
+        return page;
+    }
+
+    int find_pos(const bucket *b, const Key &key) {
+        for (int i = 0; i < b->count; ++i) {
+            if (b->key[i] == key) return i;
+        }
+        return -1;
+    }
+
+    // split the bucket at directory slot `slot`, doubling the directory if needed
+    void split(size_t slot) {
+        int old_index = m_dir[slot];
+        bucket *old_bucket = get_page(old_index).ptr;
+        int depth = old_bucket->depth;
+        if (depth == m_depth) {
+            if (m_depth == MAX_DEPTH) throw "HashIndex: too many keys with the same hash";
+            size_t n = m_dir.size();
+            m_dir.resize(n * 2);
+            for (size_t i = 0; i < n; ++i) m_dir[n + i] = m_dir[i];
+            ++m_depth;
+        }
+        int new_index;
+        page_t &new_p = new_page(depth + 1, new_index);
+        page_t &old_p = get_page(old_index);
+        bucket *b = old_p.ptr, *nb = new_p.ptr;
+        b->depth = depth + 1;
+        int cnt = 0;
+        for (int i = 0; i < b->count; ++i) {
+            if (hash(b->key[i]) >> depth & 1) {
+                nb->key[nb->count] = b->key[i];
+                nb->data[nb->count++] = b->data[i];
+            } else {
+                b->key[cnt] = b->key[i];
+                b->data[cnt++] = b->data[i];
+            }
+        }
+        b->count = cnt;
+        old_p.dirty = true;
+        // slots that share the low `depth` bits with the old bucket and have bit `depth` set
+        size_t low = slot & ((size_t(1) << depth) - 1);
+        for (size_t i = low | (size_t(1) << depth); i < m_dir.size(); i += size_t(1) << (depth + 1)) {
+            m_dir[i] = new_index;
+        }
+    }
+
+    void rebuild_filter() {
+        m_filter.reset(m_size * 2);
+        for (size_t i = 0; i < m_dir.size(); ++i) {
+            // every bucket is referenced by its lowest directory slot first
+            bucket *b = get_page(m_dir[i]).ptr;
+            if (i >= (size_t(1) << b->depth)) continue;
+            for (int j = 0; j < b->count; ++j) m_filter.insert(b->key[j]);
+        }
+    }
+
+    bool filter_may_contain(const Key &key) {
+        if constexpr(BLOOM_BITS_PER_KEY > 0) {
+            if (!m_filter.may_contain(key)) {
+                ++count_of_filter_skip;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void init_dir() {
+        m_depth = 0;
+        m_size = 0;
+        int index;
+        new_page(0, index);
+        m_dir.clear();
+        m_dir.push_back(index);
+    }
+
+  public:
+    HashIndex(const std::string &name) : data_file(name + ".idx"), dir_file_name(name + ".dir"), m_filter(name) {
+        static_assert(CAPACITY >= 2 && sizeof(bucket) <= FILE_BLOCK_SIZE,
+                      "the value type is too large, please use a larger FILE_BLOCK_SIZE");
+        if (!data_file.exist()) {
+            data_file.init();
+            init_dir();
+        } else {
+            data_file.open();
+            data_file.get_info(m_depth, 1);
+            data_file.get_info(m_size, 2);
+            std::ifstream file(dir_file_name, std::ios::binary);
+            m_dir.resize(size_t(1) << m_depth);
+            file.read(reinterpret_cast<char *>(m_dir.data()), m_dir.size() * sizeof(int));
+        }
+        if constexpr(BLOOM_BITS_PER_KEY > 0) {
+            if (!m_filter.valid(m_size)) rebuild_filter(); // missing or stale filter file
+        }
+    }
+
+    ~HashIndex() {
+        clear_cache();
+        data_file.write_info(m_depth, 1);
+        data_file.write_info(m_size, 2);
+        std::ofstream file(dir_file_name, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(m_dir.data()), m_dir.size() * sizeof(int));
+        if constexpr(BLOOM_BITS_PER_KEY > 0) m_filter.set_owner_size(m_size);
+#ifdef DEBUG
+        std::cerr << dir_file_name << ": " << m_size << " keys, 2^" << m_depth << " directory slots, "
+                  << count_of_page_read << " page reads, " << count_of_page_write << " page writes, "
+                  << count_of_filter_skip << " lookups skipped by the filter" << std::endl;
+#endif
+    }
+
+    /**
+     * @brief Inserts the key, returns false (and does nothing) if it already exists.
+     */
+    bool insert(const Key &key, const Tp &data) {
+        uint64_t h = hash(key);
+        bool maybe = filter_may_contain(key);
+        while (true) {
+            size_t slot = h & (m_dir.size() - 1);
+            page_t &page = get_page(m_dir[slot]);
+            bucket *b = page.ptr;
+            if (maybe && find_pos(b, key) != -1) return false;
+            if (b->count < CAPACITY) {
+                b->key[b->count] = key;
+                b->data[b->count++] = data;
+                page.dirty = true;
+                break;
+            }
+            split(slot);
+        }
+        ++m_size;
+        if constexpr(BLOOM_BITS_PER_KEY > 0) {
+            if (m_filter.need_rebuild(m_size)) rebuild_filter();
+            else m_filter.insert(key);
+        }
+        return true;
+    }
+
+    pair<Tp, bool> find(const Key &key) {
+        if (!filter_may_contain(key)) return pair(Tp(), false);
+        bucket *b = get_page(m_dir[hash(key) & (m_dir.size() - 1)]).ptr;
+        int pos = find_pos(b, key);
+        return pos == -1 ? pair(Tp(), false) : pair(b->data[pos], true);
+    }
+
+    size_t count(const Key &key) {
+        return find(key).second;
+    }
+
+    /**
+     * @brief Replaces the value of an existing key, returns false if the key does not exist.
+     */
+    bool modify(const Key &key, const Tp &data) {
+        if (!filter_may_contain(key)) return false;
+        page_t &page = get_page(m_dir[hash(key) & (m_dir.size() - 1)]);
+        int pos = find_pos(page.ptr, key);
+        if (pos == -1) return false;
+        page.ptr->data[pos] = data;
+        page.dirty = true;
+        return true;
+    }
+
+    bool remove(const Key &key) {
+        if (!filter_may_contain(key)) return false;
+        page_t &page = get_page(m_dir[hash(key) & (m_dir.size() - 1)]);
+        bucket *b = page.ptr;
+        int pos = find_pos(b, key);
+        if (pos == -1) return false;
+        --b->count;
+        b->key[pos] = b->key[b->count];
+        b->data[pos] = b->data[b->count];
+        page.dirty = true;
+        --m_size;
+        return true;
+    }
+
+    void clear() {
+        for (int i = cache_map.size(); i > 0; --i) {
+            delete cache_map.back().second.ptr;
+            cache_map.pop_back();
+        }
+        data_file.init();
+        init_dir();
+        if constexpr(BLOOM_BITS_PER_KEY > 0) m_filter.reset(0);
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+
+    bool empty() const {
+        return m_size == 0;
+    }
+};
+
+} // namespace sjtu
+
+#endif // HASHINDEX_HPP
@@ -13,7 +13,9 @@
 #define HASHMAP_HPP
 
 #include <cstddef>
+#include <cstring>
 #include <functional>
+#include <utility>
 #include "exceptions.hpp"
 #include "utility.hpp"
 
@@ -21,11 +23,15 @@ namespace sjtu {
 
 
 /**
- * @brief A hash map implementation using separate chaining collision resolution.
+ * @brief A flat hash map using open addressing with Robin Hood linear probing.
+ *
+ * Elements live in one power-of-two table (no allocation per insert), probing is a linear scan
+ * and the hash is mixed so that integer keys (std::hash is the identity) spread over the table.
+ * The table doubles when it is 7/8 full, deletion uses backward shifting (no tombstones).
  *
  * @tparam Key The key type.
  * @tparam Tp The value type.
- * @tparam MOD The size of the hash head table.
+ * @tparam MOD The expected number of elements, used to size the initial table.
  * @tparam Hash The hash function type.
  */
 template <class Key, class Tp, size_t MOD, class Hash = std::hash<Key>>
@@ -34,45 +40,114 @@ class Hashmap {
     typedef pair<const Key, Tp> Data_t;
   protected:
     /**
-     * @brief Node structure for storing key-value pairs.
+     * @brief Slot structure for storing key-value pairs.
      */
-    struct node {
-        Data_t data;       ///< The key-value pair.
-        node  *next;       ///< Pointer to the next node in the chain.
+    struct slot {
+        Key key;
+        Tp  value;
     };
-    node *m_data[MOD];     ///< Array of pointers to the head of each chain.
+    slot *m_slots;         ///< The table, valid where m_dist[i] != 0.
+    unsigned char *m_dist; ///< 0: empty, otherwise 1 + distance from the home slot.
+    size_t m_mask;         ///< Table size - 1, the table size is a power of two.
     size_t m_size;         ///< The number of key-value pairs in the hash map.
 
+    size_t home(const Key &key) const {
+        return hash_mix(Hash()(key)) & m_mask;
+    }
+
+    /**
+     * @brief Returns the slot index of the key, or -1 if it does not exist.
+     */
+    long find_index(const Key &key) const {
+        size_t i = home(key);
+        for (unsigned char d = 1; m_dist[i] >= d; ++d, i = (i + 1) & m_mask) {
+            if (m_dist[i] == d && m_slots[i].key == key) return i;
+        }
+        return -1;
+    }
+
+    void allocate(size_t capacity) {
+        m_slots = new slot[capacity];
+        m_dist = new unsigned char[capacity]();
+        m_mask = capacity - 1;
+    }
+
+    void rehash(size_t capacity) {
+        slot *old_slots = m_slots;
+        unsigned char *old_dist = m_dist;
+        size_t old_capacity = m_mask + 1;
+        allocate(capacity);
+        for (size_t i = 0; i < old_capacity; ++i) {
+            if (old_dist[i]) place(std::move(old_slots[i].key), std::move(old_slots[i].value));
+        }
+        delete[] old_slots;
+        delete[] old_dist;
+    }
+
+    /**
+     * @brief Puts a key known to be absent into the table, returns its slot index.
+     */
+    size_t place(Key key, Tp value) {
+        Key inserted = key;
+        size_t i = home(key), res = -1;
+        for (unsigned char d = 1; ; ++d, i = (i + 1) & m_mask) {
+            if (d == 255) { // probe sequence too long: grow, then put the element we are carrying
+                rehash((m_mask + 1) * 2);
+                place(std::move(key), std::move(value));
+                return find_index(inserted);
+            }
+            if (m_dist[i] == 0) {
+                m_slots[i].key = std::move(key);
+                m_slots[i].value = std::move(value);
+                m_dist[i] = d;
+                return res == size_t(-1) ? i : res;
+            }
+            if (m_dist[i] < d) { // the resident is closer to its home, take its place
+                std::swap(key, m_slots[i].key);
+                std::swap(value, m_slots[i].value);
+                std::swap(d, m_dist[i]);
+                if (res == size_t(-1)) res = i;
+            }
+        }
+    }
+
+    /**
+     * @brief Inserts a key known to be absent, growing the table first if needed.
+     */
+    size_t insert_new(const Key &key, const Tp &value) {
+        if ((m_size + 1) * 8 > (m_mask + 1) * 7) rehash((m_mask + 1) * 2);
+        ++m_size;
+        return place(key, value);
+    }
+
   public:
     /**
      * @brief Constructs an empty hash map.
      */
     Hashmap() {
+        size_t capacity = 16;
+        while (capacity * 7 < MOD * 8) capacity <<= 1;
+        allocate(capacity);
         m_size = 0;
-        for (size_t i = 0; i < MOD; ++i) {
-            m_data[i] = nullptr;
-        }
     }
 
     /**
      * @brief Destroys the hash map and frees the memory.
      */
     ~Hashmap() {
-        clear();
+        delete[] m_slots;
+        delete[] m_dist;
     }
 
+    Hashmap(const Hashmap &) = delete;
+    Hashmap &operator=(const Hashmap &) = delete;
+
     /**
      * @brief Removes all elements from the hash map.
      */
     void clear() {
         m_size = 0;
-        for (size_t i = 0; i < MOD; ++i) {
-            while (m_data[i]) {
-                node *tmp = m_data[i];
-                m_data[i] = m_data[i]->next;
-                delete tmp;
-            }
-        }
+        memset(m_dist, 0, m_mask + 1);
     }
 
     /**
@@ -83,16 +158,9 @@ class Hashmap {
      * @return Tp& Reference to the value associated with the key.
      */
     Tp &operator[](const Key &key) {
-        size_t h = Hash()(key) % MOD;
-        for (node *p = m_data[h]; p; p = p->next) {
-            if (p->data.first == key) {
-                return p->data.second;
-            }
-        }
-        node *tmp = new node{{key, Tp()}, m_data[h]};
-        m_data[h] = tmp;
-        ++m_size;
-        return tmp->data.second;
+        long i = find_index(key);
+        if (i == -1) i = insert_new(key, Tp());
+        return m_slots[i].value;
     }
 
     /**
@@ -104,13 +172,9 @@ class Hashmap {
      * @return Tp& Reference to the value associated with the key.
      */
     Tp &at(const Key &key) {
-        size_t h = Hash()(key) % MOD;
-        for (node *p = m_data[h]; p; p = p->next) {
-            if (p->data.first == key) {
-                return p->value;
-            }
-        }
-        throw sjtu::index_out_of_bound();
+        long i = find_index(key);
+        if (i == -1) throw sjtu::index_out_of_bound();
+        return m_slots[i].value;
     }
 
     /**
@@ -120,21 +184,19 @@ class Hashmap {
      * @return true if the key-value pair was found and erased, false otherwise.
      */
     bool erase(const Key &key) {
-        size_t h = Hash()(key) % MOD;
-        node *p = m_data[h], *last = nullptr;
-        for (; p; last = p, p = p->next) {
-            if (p->data.first == key) {
-                if (last) {
-                    last->next = p->next;
-                } else {
-                    m_data[h] = p->next;
-                }
-                delete p;
-                --m_size;
-                return true;
-            }
+        long pos = find_index(key);
+        if (pos == -1) return false;
+        size_t i = pos, j = (i + 1) & m_mask;
+        // shift the following elements of the cluster one slot back
+        while (m_dist[j] > 1) {
+            m_slots[i] = std::move(m_slots[j]);
+            m_dist[i] = m_dist[j] - 1;
+            i = j;
+            j = (j + 1) & m_mask;
         }
-        return false;
+        m_dist[i] = 0;
+        --m_size;
+        return true;
     }
 
     /**
@@ -143,14 +205,8 @@ class Hashmap {
      * @param key The key to count.
      * @return size_t The number of key-value pairs with the given key.
      */
-    size_t count(const Key &key) {
-        size_t h = Hash()(key) % MOD;
-        for (node *p = m_data[h]; p; p = p->next) {
-            if (p->data.first == key) {
-                return 1;
-            }
-        }
-        return 0;
+    size_t count(const Key &key) const {
+        return find_index(key) != -1;
     }
 
 
@@ -162,18 +218,30 @@ class Hashmap {
      * @return true if the key-value pair was inserted, false otherwise.
      */
     bool insert(const Data_t &data) {
-        size_t h = Hash()(data.first) % MOD;
-        for (node *p = m_data[h]; p; p = p->next) {
-            if (p->data.first == data.first) {
-                return false;
-            }
-        }
-        node *tmp = new node{data, m_data[h]};
-        m_data[h] = tmp;
-        ++m_size;
+        if (find_index(data.first) != -1) return false;
+        insert_new(data.first, data.second);
         return true;
     }
 
+    /**
+     * @brief Calls f(key, value) for every key-value pair, in table order.
+     */
+    template <class F>
+    void for_each(F f) const {
+        for (size_t i = 0; i <= m_mask; ++i) {
+            if (m_dist[i]) f(m_slots[i].key, m_slots[i].value);
+        }
+    }
+
+    /**
+     * @brief Makes room for n elements without rehashing.
+     */
+    void reserve(size_t n) {
+        size_t capacity = m_mask + 1;
+        while (capacity * 7 < n * 8) capacity <<= 1;
+        if (capacity != m_mask + 1) rehash(capacity);
+    }
+
     /**
      * @brief Returns the number of key-value pairs in the hash map.
      *
@@ -328,6 +396,23 @@ class LRUHashmap {
         return false;
     }
 
+    /**
+     * @brief Returns the least recently used key-value pair (the one pop_back() removes).
+     * The hash map must not be empty.
+     */
+    data_t &back() {
+        return m_list_tail->list_prev->data;
+    }
+
+    /**
+     * @brief Calls f(key, value) for every key-value pair, from the most recently used,
+     * without changing the order.
+     */
+    template <class F>
+    void for_each(F f) {
+        for (node *p = m_list_head; p != m_list_tail; p = p->list_next) f(p->data.first, p->data.second);
+    }
+
     /**
      * @brief Removes the last key-value pair from the hash map.
      */
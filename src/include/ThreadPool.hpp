@@ -0,0 +1,109 @@
+/**
+ * @file ThreadPool.hpp
+ * @brief A fixed pool of worker threads running parallel-for jobs
+ *
+ */
+
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace sjtu {
+
+/**
+ * @brief A fixed set of threads that run one parallel-for job at a time.
+ *
+ * run(n, f) calls f(worker, task) for every task in [0, n), tasks are handed out in increasing
+ * order to whichever worker is free, and `worker` (in [0, size())) identifies the calling thread so
+ * that f can use per-worker scratch state. The calling thread works as worker 0, run() returns
+ * when every task is done.
+ */
+class ThreadPool {
+  private:
+    std::thread *threads;
+    int thread_count;
+    std::mutex mutex;
+    std::condition_variable start_cv, done_cv;
+    std::function<void(int, int)> job;
+    std::atomic<int> next_task;
+    int task_count = 0;
+    int busy = 0;         // workers (other than the caller) still in the current job
+    size_t generation = 0; // incremented for every job
+    bool stopping = false;
+
+    void work(int worker) {
+        int task;
+        while ((task = next_task.fetch_add(1)) < task_count) job(worker, task);
+    }
+
+    void loop(int worker) {
+        size_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_cv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) return;
+                seen = generation;
+            }
+            work(worker);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0) done_cv.notify_one();
+        }
+    }
+
+  public:
+    /**
+     * @brief Starts `n - 1` threads (the caller of run() is the n-th worker).
+     */
+    ThreadPool(int n) {
+        thread_count = n > 1 ? n - 1 : 0;
+        threads = new std::thread[thread_count];
+        for (int i = 0; i < thread_count; ++i) threads[i] = std::thread(&ThreadPool::loop, this, i + 1);
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start_cv.notify_all();
+        for (int i = 0; i < thread_count; ++i) threads[i].join();
+        delete[] threads;
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    int size() const {
+        return thread_count + 1;
+    }
+
+    void run(int n, std::function<void(int, int)> f) {
+        if (thread_count == 0 || n <= 1) {
+            for (int i = 0; i < n; ++i) f(0, i);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = std::move(f);
+            task_count = n;
+            next_task = 0;
+            busy = thread_count;
+            ++generation;
+        }
+        start_cv.notify_all();
+        work(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [&] { return busy == 0; });
+    }
+};
+
+} // namespace sjtu
+
+#endif // THREADPOOL_HPP
@@ -16,6 +16,7 @@
 #include <climits>
 #include <cstddef>
 #include <memory>
+#include <utility>
 
 namespace sjtu {
 /**
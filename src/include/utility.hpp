@@ -4,6 +4,7 @@
 #include <utility>
 #include <iostream>
 #include <chrono>
+#include <cstdint>
 
 
 namespace sjtu {
@@ -51,6 +52,19 @@ int Camp(const Tp &x, const Tp &y) {
     return x < y ? -1 : (x == y ? 0 : 1);
 }
 
+/**
+ * @brief Scrambles a hash value (the splitmix64 finalizer) so that every input bit reaches the low bits.
+ *
+ * std::hash is the identity on integers, so hash tables and filters that keep only some bits of the
+ * hash pass it through here first.
+ */
+inline uint64_t hash_mix(uint64_t h) {
+    h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
 /**
  * @brief A class template that represents a pair of values.
  *
@@ -11,14 +11,23 @@ bool Run() {
 void ClearFile() {
     CERR("Clearing files...\n");
     CERR("fileremove TrainsData.dat %d\n", std::remove("TrainsData.dat"));
-    CERR("fileremove TrainsState.db %d\n", std::remove("TrainsState.db"));
-    CERR("fileremove TrainUnitMap.db %d\n", std::remove("TrainUnitMap.db"));
+    CERR("fileremove TrainsData.vec %d\n", std::remove("TrainsData.vec"));
+    CERR("fileremove RouteStops.vec %d\n", std::remove("RouteStops.vec"));
+    CERR("fileremove RouteBegin.vec %d\n", std::remove("RouteBegin.vec"));
+    CERR("fileremove TrainsState.idx %d\n", std::remove("TrainsState.idx"));
+    CERR("fileremove TrainsState.dir %d\n", std::remove("TrainsState.dir"));
+    CERR("fileremove TrainsState.bloom %d\n", std::remove("TrainsState.bloom"));
+    CERR("fileremove Waitlist.dat %d\n", std::remove("Waitlist.dat"));
     CERR("fileremove SeatsData.dat %d\n", std::remove("SeatsData.dat"));
-    CERR("fileremove StationMap.db %d\n", std::remove("StationMap.db"));
+    CERR("fileremove SeatsTrains.vec %d\n", std::remove("SeatsTrains.vec"));
+    CERR("fileremove SeatsRows.vec %d\n", std::remove("SeatsRows.vec"));
+    CERR("fileremove StationPostings.dat %d\n", std::remove("StationPostings.dat"));
+    CERR("fileremove StationNames.vec %d\n", std::remove("StationNames.vec"));
     CERR("fileremove OrdersData.dat %d\n", std::remove("OrdersData.dat"));
     CERR("fileremove TrainIDArray.vec %d\n", std::remove("TrainIDArray.vec"));
     CERR("fileremove UserOrders.db %d\n", std::remove("UserOrders.db"));
-    CERR("fileremove Users.map %d\n", std::remove("Users.map"));
+    CERR("fileremove Users.idx %d\n", std::remove("Users.idx"));
+    CERR("fileremove Users.dir %d\n", std::remove("Users.dir"));
 }
 
 
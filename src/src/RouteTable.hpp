@@ -0,0 +1,69 @@
+#ifndef _ROUTE_TABLE_HPP_
+#define _ROUTE_TABLE_HPP_
+
+#include "Hashmap.hpp"
+#include "File.hpp"
+#include "utils.hpp"
+#include <cstring>
+#include <string>
+
+namespace sjtu {
+
+// distinct station sequences <-> dense route ids, trains running the same stations share one route;
+// the stations are saved to <name>Stops.vec and <name>Begin.vec on exit
+class RouteTable {
+    VectorFile<stationID_t> stops; // the stations of every route, back to back
+    VectorFile<int> begin; // route -> its first stop, begin[route + 1] is the end
+    Hashmap<size_t, int, 1024> ids; // hash of the stations -> route, colliding routes take the next free hash
+
+    static size_t hash(const stationID_t *stations, int n) {
+        size_t h = RANDDOM_HASH_SEED;
+        for (int i = 0; i < n; ++i) h = h * 131 + stations[i];
+        return h * 131 + n;
+    }
+
+    bool equal(int route, const stationID_t *stations, int n) const {
+        return length(route) == n && memcmp(this->stations(route), stations, n * sizeof(stationID_t)) == 0;
+    }
+
+    // the slot of a station sequence in ids: where it is, or the free slot where it would go
+    size_t slot(const stationID_t *stations, int n) {
+        size_t h = hash(stations, n);
+        while (ids.count(h) && !equal(ids.at(h), stations, n)) ++h;
+        return h;
+    }
+
+  public:
+    RouteTable(const std::string &name) : stops(name + "Stops"), begin(name + "Begin") {
+        if (begin.empty()) begin.push_back(0);
+        ids.reserve(size());
+        for (int r = 0; r < size(); ++r) ids[slot(stations(r), length(r))] = r;
+    }
+
+    // the route of a station sequence, a new one if no train ran it before
+    int intern(const stationID_t *stations, int n) {
+        size_t h = slot(stations, n);
+        if (!ids.count(h)) {
+            ids[h] = size();
+            for (int i = 0; i < n; ++i) stops.push_back(stations[i]);
+            begin.push_back(stops.size());
+        }
+        return ids.at(h);
+    }
+
+    const stationID_t *stations(int route) const {
+        return stops.data() + begin[route];
+    }
+
+    int length(int route) const {
+        return begin[route + 1] - begin[route];
+    }
+
+    int size() const {
+        return begin.size() - 1;
+    }
+};
+
+} // namespace sjtu
+
+#endif // _ROUTE_TABLE_HPP_
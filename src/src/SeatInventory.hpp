@@ -0,0 +1,412 @@
+#ifndef _SEAT_INVENTORY_HPP_
+#define _SEAT_INVENTORY_HPP_
+
+#include "Vector.hpp"
+#include "Hashmap.hpp"
+#include "File.hpp"
+#include "utility.hpp"
+#include "utils.hpp"
+#include "Train.hpp"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+namespace sjtu {
+
+// min of a[0 .. n), a plain loop the compiler turns into SIMD min instructions
+inline int seatScanMin(const int *a, int n) {
+    int res = 0x3f3f3f3f;
+    for (int i = 0; i < n; ++i) res = a[i] < res ? a[i] : res;
+    return res;
+}
+
+// seats left on each segment of one train on one day, as a sqrt-blocked array: every block of
+// BLOCK segments keeps its min and a pending add, so min and add over [from, to) cost O(sqrt n).
+// Ranges inside a block (short routes) and the partial blocks at both ends are scanned directly.
+struct SeatRow {
+    static constexpr int BLOCK = 10;
+    static constexpr int BLOCKS = (maxSTATION + BLOCK - 1) / BLOCK;
+
+    seatinfo_t count;     // without blockAdd
+    int blockMin[BLOCKS]; // min of count[] in the block, without blockAdd
+    int blockAdd[BLOCKS]; // added to every segment of the block
+
+    // the first n segments from seats[], the others are 0
+    void load(const int *seats, int n) {
+        memcpy(count, seats, n * sizeof(int));
+        memset(count + n, 0, (maxSTATION - n) * sizeof(int));
+        for (int b = 0; b < BLOCKS; ++b) {
+            blockAdd[b] = 0;
+            blockMin[b] = seatScanMin(count + b * BLOCK, blockSize(b));
+        }
+    }
+
+    // every segment has `seats` left
+    void fill(int seats, int n) {
+        for (int i = 0; i < n; ++i) count[i] = seats;
+        memset(count + n, 0, (maxSTATION - n) * sizeof(int));
+        for (int b = 0; b < BLOCKS; ++b) {
+            blockAdd[b] = 0;
+            blockMin[b] = seatScanMin(count + b * BLOCK, blockSize(b));
+        }
+    }
+
+    // the first n segments into seats[]
+    void store(int *seats, int n) const {
+        for (int i = 0; i < n; ++i) seats[i] = count[i] + blockAdd[i / BLOCK];
+    }
+
+    static int blockSize(int b) {
+        return b * BLOCK + BLOCK <= maxSTATION ? BLOCK : maxSTATION - b * BLOCK;
+    }
+
+    // res[j - from] = min over the segments [from, j], for every j in [from, to)
+    void prefixMin(int from, int to, int *res) const {
+        int left = 0x3f3f3f3f;
+        for (int i = from; i < to; ++i) {
+            int seats = count[i] + blockAdd[i / BLOCK];
+            if (seats < left) left = seats;
+            res[i - from] = left;
+        }
+    }
+
+    // min over the segments [from, to), 0x3f3f3f3f if the range is empty
+    int min(int from, int to) const {
+        if (from >= to) return 0x3f3f3f3f;
+        int fb = from / BLOCK, lb = (to - 1) / BLOCK;
+        if (fb == lb) return seatScanMin(count + from, to - from) + blockAdd[fb];
+        int res = seatScanMin(count + from, fb * BLOCK + BLOCK - from) + blockAdd[fb];
+        for (int b = fb + 1; b < lb; ++b) res = std::min(res, blockMin[b] + blockAdd[b]);
+        return std::min(res, seatScanMin(count + lb * BLOCK, to - lb * BLOCK) + blockAdd[lb]);
+    }
+
+    // adds delta to the segments [from, to)
+    void add(int from, int to, int delta) {
+        if (from >= to) return;
+        int fb = from / BLOCK, lb = (to - 1) / BLOCK;
+        if (fb == lb) {
+            addPartial(fb, from, to, delta);
+            return;
+        }
+        addPartial(fb, from, fb * BLOCK + BLOCK, delta);
+        for (int b = fb + 1; b < lb; ++b) blockAdd[b] += delta;
+        addPartial(lb, lb * BLOCK, to, delta);
+    }
+
+  private:
+    void addPartial(int b, int from, int to, int delta) {
+        for (int i = from; i < to; ++i) count[i] += delta;
+        blockMin[b] = seatScanMin(count + b * BLOCK, blockSize(b));
+    }
+};
+
+// a seat row wanted by a batched query, with the segments [from, to) to take the min over
+struct SeatQuery {
+    int seatIndex;
+    int day;
+    int from, to;
+    int seats; // filled by SeatInventory::query
+    int *seatsTo = nullptr; // if set, filled with the min over [from, j] for every segment j in [from, to)
+};
+
+// where the seats of one released train live
+struct SeatTrain {
+    int seatNum;
+    int segments; // stationNum - 1
+    int begDay;   // salebeg.getDDate()
+    int days;     // saleend - salebeg + 1
+    int first;    // its first day in rowOffset
+};
+
+// the seats of every released train. SeatsData.dat only holds the rows of (train, day) that were
+// ever sold, each right-sized to `segments` counts and placed on its first write; a day that
+// was never written is virtual (every segment has seatNum). The directory (SeatsTrains.vec,
+// SeatsRows.vec) is kept in memory. The rows in use are kept as SeatRow in a bounded LRU cache
+// shared by every query and order; changed rows are only marked dirty and written back when they
+// leave the cache or at a checkpoint (flush(), also run on exit).
+//
+// DATE_MAJOR picks the layout of SeatsData.dat: false appends every row at the end of the file,
+// true clusters the rows of one day in extents reserved for that day, so that the rows read by one
+// query_ticket (one day, many trains) are close together and fetched by a few coalesced reads.
+// Extents are not reopened after a restart, their unused tails stay empty.
+template <bool DATE_MAJOR = false>
+class SeatInventory {
+    static constexpr int CACHE_ROWS = 4096;
+    static constexpr long long MAX_READ = 1 << 16; // bytes of one coalesced read
+    static constexpr long long MAX_GAP = 1 << 12;  // unused bytes a coalesced read may span
+    static constexpr long long EXTENT = 1 << 14;   // bytes reserved at a time for one day (DATE_MAJOR)
+    static constexpr long long VIRTUAL = -1;
+
+    std::fstream file;
+    long long file_end;
+    long long extentPos[maxDURATION], extentEnd[maxDURATION]; // free space of each day (DATE_MAJOR)
+    VectorFile<SeatTrain> trains; // seatIndex -> SeatTrain
+    VectorFile<long long> rowOffset; // trains[seatIndex].first + day - begDay -> offset in SeatsData.dat
+    struct cached_t {
+        SeatRow row;
+        bool dirty = false;
+    };
+
+    LRUHashmap<size_t, cached_t, 4099> cache; // (seatIndex, day) -> row
+    vector<int> misses;
+    vector<int> buffer;
+    seatinfo_t write_buffer;
+
+    size_t count_of_row = 0;     // rows asked for
+    size_t count_of_row_hit = 0; // rows found in the cache
+    size_t count_of_read = 0;    // reads from SeatsData
+    size_t count_of_update = 0;  // rows changed
+    size_t count_of_write = 0;   // row writes to SeatsData
+    size_t count_of_alloc = 0;   // rows made real by their first write
+    size_t count_of_read_bytes = 0;
+
+    static size_t rowKey(int seatIndex, int day) {
+        return size_t(seatIndex) * maxDURATION + day;
+    }
+
+    long long &offset(int seatIndex, int day) {
+        const SeatTrain &train = trains[seatIndex];
+        return rowOffset[train.first + day - train.begDay];
+    }
+
+    // the place of a new row of `size` bytes
+    long long allocate(int day, long long size) {
+        long long res;
+        if constexpr (DATE_MAJOR) {
+            if (extentPos[day] + size > extentEnd[day]) {
+                extentPos[day] = file_end;
+                file_end += EXTENT;
+                extentEnd[day] = file_end;
+            }
+            res = extentPos[day];
+            extentPos[day] += size;
+        } else {
+            res = file_end;
+            file_end += size;
+        }
+        return res;
+    }
+
+    void writeBack(size_t key, cached_t &cached) {
+        if (!cached.dirty) return;
+        int seatIndex = key / maxDURATION, day = key % maxDURATION;
+        const SeatTrain &train = trains[seatIndex];
+        long long &pos = offset(seatIndex, day);
+        if (pos == VIRTUAL) { // the first write of the row
+            pos = allocate(day, train.segments * sizeof(int));
+            ++count_of_alloc;
+        }
+        cached.row.store(write_buffer, train.segments);
+        file.clear();
+        file.seekp(pos);
+        file.write(reinterpret_cast<const char *>(write_buffer), train.segments * sizeof(int));
+        cached.dirty = false;
+        ++count_of_write;
+    }
+
+    SeatRow &cacheRow(int seatIndex, int day) {
+        size_t key = rowKey(seatIndex, day);
+        if (!cache.check(key)) {
+            while (cache.size() >= CACHE_ROWS) {
+                auto &p = cache.back();
+                writeBack(p.first, p.second);
+                cache.pop_back();
+            }
+        }
+        return cache.at(key).row;
+    }
+
+  public:
+    // files: <name>Data.dat, <name>Trains.vec, <name>Rows.vec
+    SeatInventory(const std::string &name) : trains(name + "Trains"), rowOffset(name + "Rows") {
+        std::string path = name + "Data.dat";
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file.good()) {
+            file.close();
+            file.open(path, std::ios::out | std::ios::binary);
+            file.close();
+            file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        }
+        file.seekp(0, std::ios::end);
+        file_end = file.tellp();
+        for (int i = 0; i < maxDURATION; ++i) extentPos[i] = extentEnd[i] = 0;
+    }
+
+    ~SeatInventory() {
+        flush();
+#ifdef DEBUG
+        fprintf(stderr, "seat rows %zu requested, %zu cached, %zu reads (%zu bytes), %zu updates, %zu writes, "
+                "%zu allocated\n", count_of_row, count_of_row_hit, count_of_read, count_of_read_bytes, count_of_update,
+                count_of_write, count_of_alloc);
+#endif
+    }
+
+    // checkpoint: writes every dirty row back, the rows stay cached
+    void flush() {
+        cache.for_each([&](const size_t &key, cached_t &cached) {
+            writeBack(key, cached);
+        });
+        file.flush();
+    }
+
+    // the seats of a train being released, every day is virtual (all seatNum) until its first sale
+    int create(const Train &train) {
+        SeatTrain res;
+        res.seatNum = train.seatNum;
+        res.segments = train.stationNum - 1;
+        res.begDay = train.salebeg.getDDate();
+        res.days = train.saleend.getDDate() - res.begDay + 1;
+        res.first = rowOffset.size();
+        for (int i = 0; i < res.days; ++i) rowOffset.push_back(VIRTUAL);
+        trains.push_back(res);
+        return trains.size() - 1;
+    }
+
+    // the row of a train on a day, valid until the next call into the inventory
+    SeatRow &row(int seatIndex, int day) {
+        ++count_of_row;
+        size_t key = rowKey(seatIndex, day);
+        if (cache.check(key)) {
+            ++count_of_row_hit;
+            return cache.at(key).row;
+        }
+        const SeatTrain &train = trains[seatIndex];
+        long long pos = offset(seatIndex, day);
+        SeatRow &res = cacheRow(seatIndex, day);
+        if (pos == VIRTUAL) {
+            res.fill(train.seatNum, train.segments);
+        } else {
+            ++count_of_read;
+            count_of_read_bytes += train.segments * sizeof(int);
+            buffer.resize(train.segments);
+            file.clear();
+            file.seekg(pos);
+            file.read(reinterpret_cast<char *>(buffer.data()), train.segments * sizeof(int));
+            res.load(buffer.data(), train.segments);
+        }
+        return res;
+    }
+
+    // marks a row changed through row() as dirty, it is written back later
+    void update(int seatIndex, int day) {
+        cache.at(rowKey(seatIndex, day)).dirty = true;
+        ++count_of_update;
+    }
+
+    int query(int seatIndex, int day, int from, int to) {
+        return row(seatIndex, day).min(from, to);
+    }
+
+    void add(int seatIndex, int day, int from, int to, int delta) {
+        row(seatIndex, day).add(from, to, delta);
+        update(seatIndex, day);
+    }
+
+    // every segment of a row
+    void get(int seatIndex, int day, seatinfo_t &seats) {
+        row(seatIndex, day).store(seats, trains[seatIndex].segments);
+    }
+
+    // every segment of `days` rows of a train from `day` on, row after row: cached and virtual rows
+    // need no read, the others are read in file order as query(batch) does but not cached;
+    // returns the number of reads
+    int get(int seatIndex, int day, int days, int *seats) {
+        const SeatTrain &train = trains[seatIndex];
+        int n = train.segments, reads = 0;
+        misses.clear();
+        for (int d = 0; d < days; ++d) {
+            ++count_of_row;
+            size_t key = rowKey(seatIndex, day + d);
+            if (cache.check(key)) {
+                ++count_of_row_hit;
+                cache.at(key).row.store(seats + d * n, n);
+            } else if (offset(seatIndex, day + d) == VIRTUAL) {
+                for (int i = 0; i < n; ++i) seats[d * n + i] = train.seatNum;
+            } else {
+                misses.push_back(d);
+            }
+        }
+        sort(misses.begin(), misses.end(), [&](int a, int b) {
+            return offset(seatIndex, day + a) < offset(seatIndex, day + b);
+        });
+        for (int i = 0, j; i < misses.size(); i = j) {
+            long long beg = offset(seatIndex, day + misses[i]), end = beg + n * sizeof(int);
+            for (j = i + 1; j < misses.size(); ++j) {
+                long long pos = offset(seatIndex, day + misses[j]);
+                if (pos > end + MAX_GAP || pos + n * sizeof(int) - beg > MAX_READ) break;
+                if (pos + n * sizeof(int) > end) end = pos + n * sizeof(int);
+            }
+            buffer.resize((end - beg) / sizeof(int));
+            count_of_read_bytes += end - beg;
+            file.clear();
+            file.seekg(beg);
+            file.read(reinterpret_cast<char *>(buffer.data()), end - beg);
+            ++reads;
+            for (int k = i; k < j; ++k) {
+                const int *row = buffer.data() + (offset(seatIndex, day + misses[k]) - beg) / sizeof(int);
+                memcpy(seats + misses[k] * n, row, n * sizeof(int));
+            }
+        }
+        count_of_read += reads;
+        return reads;
+    }
+
+    // fills the seats of every query: cached and virtual rows need no read, the others are read in
+    // file order with one read per run of rows at most MAX_GAP apart; returns the number of reads
+    int query(vector<SeatQuery> &batch) {
+        int n = batch.size(), reads = 0;
+        misses.clear();
+        for (int i = 0; i < n; ++i) {
+            SeatQuery &q = batch[i];
+            ++count_of_row;
+            size_t key = rowKey(q.seatIndex, q.day);
+            if (cache.check(key)) {
+                ++count_of_row_hit;
+                const SeatRow &row = cache.at(key).row;
+                q.seats = row.min(q.from, q.to);
+                if (q.seatsTo != nullptr) row.prefixMin(q.from, q.to, q.seatsTo);
+            } else if (offset(q.seatIndex, q.day) == VIRTUAL) {
+                q.seats = q.from < q.to ? trains[q.seatIndex].seatNum : 0x3f3f3f3f;
+                if (q.seatsTo != nullptr) {
+                    for (int j = q.from; j < q.to; ++j) q.seatsTo[j - q.from] = trains[q.seatIndex].seatNum;
+                }
+            } else {
+                misses.push_back(i);
+            }
+        }
+        sort(misses.begin(), misses.end(), [&](int a, int b) {
+            return offset(batch[a].seatIndex, batch[a].day) < offset(batch[b].seatIndex, batch[b].day);
+        });
+        for (int i = 0, j; i < misses.size(); i = j) {
+            long long beg = offset(batch[misses[i]].seatIndex, batch[misses[i]].day);
+            long long end = beg + trains[batch[misses[i]].seatIndex].segments * sizeof(int);
+            for (j = i + 1; j < misses.size(); ++j) {
+                const SeatQuery &q = batch[misses[j]];
+                long long pos = offset(q.seatIndex, q.day);
+                long long next = pos + trains[q.seatIndex].segments * sizeof(int);
+                if (pos > end + MAX_GAP || next - beg > MAX_READ) break;
+                if (next > end) end = next;
+            }
+            buffer.resize((end - beg) / sizeof(int));
+            count_of_read_bytes += end - beg;
+            file.clear();
+            file.seekg(beg);
+            file.read(reinterpret_cast<char *>(buffer.data()), end - beg);
+            ++reads;
+            for (int k = i; k < j; ++k) {
+                SeatQuery &q = batch[misses[k]];
+                SeatRow &row = cacheRow(q.seatIndex, q.day);
+                row.load(buffer.data() + (offset(q.seatIndex, q.day) - beg) / sizeof(int), trains[q.seatIndex].segments);
+                q.seats = row.min(q.from, q.to);
+                if (q.seatsTo != nullptr) row.prefixMin(q.from, q.to, q.seatsTo);
+            }
+        }
+        count_of_read += reads;
+        return reads;
+    }
+};
+
+} // namespace sjtu
+
+#endif // _SEAT_INVENTORY_HPP_
@@ -0,0 +1,56 @@
+#ifndef _STATION_DICT_HPP_
+#define _STATION_DICT_HPP_
+
+#include "Hashmap.hpp"
+#include "File.hpp"
+#include "utils.hpp"
+#include <string>
+
+namespace sjtu {
+
+// station name <-> dense stationID_t (0, 1, 2, ...), the names are saved to <name>.vec on exit
+class StationDict {
+    VectorFile<stationName_t> names; // id -> name
+    Hashmap<size_t, stationID_t, 1024> ids; // string_hash(name) -> id, colliding names take the next free hash
+
+    // the slot of a name in ids: where it is, or the free slot where it would go
+    size_t slot(const stationName_t &name) {
+        size_t h = string_hash(name);
+        while (ids.count(h) && !(names[ids.at(h)] == name)) ++h;
+        return h;
+    }
+
+  public:
+    StationDict(const std::string &name) : names(name) {
+        ids.reserve(names.size());
+        for (size_t i = 0; i < names.size(); ++i) ids[slot(names[i])] = i;
+    }
+
+    // the id of a name, -1 if it was never interned
+    stationID_t find(const stationName_t &name) {
+        size_t h = slot(name);
+        return ids.count(h) ? ids.at(h) : -1;
+    }
+
+    // the id of a name, a new one if the name is new
+    stationID_t intern(const stationName_t &name) {
+        size_t h = slot(name);
+        if (!ids.count(h)) {
+            ids[h] = names.size();
+            names.push_back(name);
+        }
+        return ids.at(h);
+    }
+
+    const stationName_t &name(stationID_t id) const {
+        return names[id];
+    }
+
+    size_t size() const {
+        return names.size();
+    }
+};
+
+} // namespace sjtu
+
+#endif // _STATION_DICT_HPP_
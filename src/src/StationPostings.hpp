@@ -0,0 +1,182 @@
+#ifndef _STATION_POSTINGS_HPP_
+#define _STATION_POSTINGS_HPP_
+
+#include "Vector.hpp"
+#include "Hashmap.hpp"
+#include "utility.hpp"
+#include "utils.hpp"
+#include "Train.hpp"
+#include <fstream>
+#include <string>
+
+namespace sjtu {
+
+// the released trains through one station, sorted by trainIndex, one column per TrainLite field
+struct StationPostingList {
+    vector<int> trainIndex;
+    vector<int> seatIndex;
+    vector<price_t> price;
+    vector<int> leavingTimes;
+    vector<int> arrivingTimes;
+    vector<char> salebegDD;
+    vector<char> saleendDD;
+    vector<char> pos;
+    vector<char> last;
+
+    size_t size() const {
+        return trainIndex.size();
+    }
+
+    TrainLite at(size_t i) const {
+        TrainLite lite;
+        lite.trainIndex = trainIndex[i];
+        lite.seatIndex = seatIndex[i];
+        lite.price = price[i];
+        lite.leavingTimes = leavingTimes[i];
+        lite.arrivingTimes = arrivingTimes[i];
+        lite.salebegDD = salebegDD[i];
+        lite.saleendDD = saleendDD[i];
+        lite.pos = pos[i];
+        lite.last = last[i];
+        return lite;
+    }
+
+    void insert(const TrainLite &lite) {
+        // trains are usually released in trainIndex order, so this is an append
+        size_t i = size();
+        while (i > 0 && trainIndex[i - 1] > lite.trainIndex) --i;
+        trainIndex.insert(i, lite.trainIndex);
+        seatIndex.insert(i, lite.seatIndex);
+        price.insert(i, lite.price);
+        leavingTimes.insert(i, lite.leavingTimes);
+        arrivingTimes.insert(i, lite.arrivingTimes);
+        salebegDD.insert(i, lite.salebegDD);
+        saleendDD.insert(i, lite.saleendDD);
+        pos.insert(i, lite.pos);
+        last.insert(i, lite.last);
+    }
+};
+
+// station id -> StationPostingList, kept in memory and saved to <name>.dat on exit
+class StationPostings {
+    std::string file_name;
+    Hashmap<size_t, int, 1024> index; // station id -> lists
+    vector<size_t> keys;
+    vector<StationPostingList *> lists;
+    StationPostingList empty_list;
+
+    template <class T>
+    static void readColumn(std::ifstream &file, vector<T> &col, size_t n) {
+        col.resize(n);
+        file.read(reinterpret_cast<char *>(col.data()), n * sizeof(T));
+    }
+    template <class T>
+    static void writeColumn(std::ofstream &file, const vector<T> &col) {
+        file.write(reinterpret_cast<const char *>(col.data()), col.size() * sizeof(T));
+    }
+
+  public:
+    StationPostings(std::string name) : file_name(name + ".dat") {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.good()) return;
+        size_t count = 0;
+        file.read(reinterpret_cast<char *>(&count), sizeof(size_t));
+        for (size_t k = 0; k < count && file.good(); ++k) {
+            size_t key, n;
+            file.read(reinterpret_cast<char *>(&key), sizeof(size_t));
+            file.read(reinterpret_cast<char *>(&n), sizeof(size_t));
+            StationPostingList &list = get(key);
+            readColumn(file, list.trainIndex, n);
+            readColumn(file, list.seatIndex, n);
+            readColumn(file, list.price, n);
+            readColumn(file, list.leavingTimes, n);
+            readColumn(file, list.arrivingTimes, n);
+            readColumn(file, list.salebegDD, n);
+            readColumn(file, list.saleendDD, n);
+            readColumn(file, list.pos, n);
+            readColumn(file, list.last, n);
+        }
+    }
+
+    ~StationPostings() {
+        std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+        size_t count = lists.size();
+        file.write(reinterpret_cast<const char *>(&count), sizeof(size_t));
+        for (size_t k = 0; k < count; ++k) {
+            const StationPostingList &list = *lists[k];
+            size_t n = list.size();
+            file.write(reinterpret_cast<const char *>(&keys[k]), sizeof(size_t));
+            file.write(reinterpret_cast<const char *>(&n), sizeof(size_t));
+            writeColumn(file, list.trainIndex);
+            writeColumn(file, list.seatIndex);
+            writeColumn(file, list.price);
+            writeColumn(file, list.leavingTimes);
+            writeColumn(file, list.arrivingTimes);
+            writeColumn(file, list.salebegDD);
+            writeColumn(file, list.saleendDD);
+            writeColumn(file, list.pos);
+            writeColumn(file, list.last);
+            delete lists[k];
+        }
+    }
+
+    StationPostings(const StationPostings &) = delete;
+    StationPostings &operator=(const StationPostings &) = delete;
+
+    // the list of a station, created empty if the station is new
+    StationPostingList &get(size_t station) {
+        if (!index.count(station)) {
+            index[station] = lists.size();
+            keys.push_back(station);
+            lists.push_back(new StationPostingList);
+        }
+        return *lists[index.at(station)];
+    }
+
+    // the list of a station, an empty list if no released train stops there
+    const StationPostingList &find(size_t station) {
+        return index.count(station) ? *lists[index.at(station)] : empty_list;
+    }
+
+    void insert(size_t station, const TrainLite &lite) {
+        get(station).insert(lite);
+    }
+
+    // calls f(i, j) for every train in both lists (a.trainIndex[i] == b.trainIndex[j]) in trainIndex
+    // order; walks the shorter list and gallops (exponential then binary search) through the longer one
+    template <class F>
+    static void intersect(const StationPostingList &a, const StationPostingList &b, F f) {
+        bool swapped = a.size() > b.size();
+        const vector<int> &s = swapped ? b.trainIndex : a.trainIndex;
+        const vector<int> &l = swapped ? a.trainIndex : b.trainIndex;
+        int ns = s.size(), nl = l.size(), lo = 0;
+        for (int i = 0; i < ns && lo < nl; ++i) {
+            int x = s[i];
+            if (l[lo] < x) {
+                int step = 1;
+                while (lo + step < nl && l[lo + step] < x) {
+                    lo += step;
+                    step <<= 1;
+                }
+                // l[lo] < x, and the first l[] >= x is in (lo, hi]
+                int hi = lo + step < nl ? lo + step : nl;
+                ++lo;
+                while (lo < hi) {
+                    int mid = (lo + hi) >> 1;
+                    if (l[mid] < x) lo = mid + 1;
+                    else hi = mid;
+                }
+                if (lo == nl) break;
+            }
+            if (l[lo] == x) {
+                if (swapped) f(lo, i);
+                else f(i, lo);
+                ++lo;
+            }
+        }
+    }
+};
+
+} // namespace sjtu
+
+#endif // _STATION_POSTINGS_HPP_
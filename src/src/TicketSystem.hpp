@@ -23,12 +23,14 @@ class TicketSystem : command_helper, TrainSystem, UserSystem {
     Timer query_order_timer;
     Timer query_train_timer;
     Timer query_transfer_timer;
+    Timer query_route_timer;
+    Timer query_board_timer;
     Timer refund_ticket_timer;
     Timer tot_timer;
   public:
     TicketSystem() : query_profile_timer("query_profile"), buy_ticket_timer("buy_ticket"),
         query_ticket_timer("query_ticket"), tot_timer("tot"), query_order_timer("query_order"), 
-        modify_profile_timer("modify_profile"),query_train_timer("query_train"), query_transfer_timer("query_transfer"),
+        modify_profile_timer("modify_profile"),query_train_timer("query_train"), query_transfer_timer("query_transfer"), query_route_timer("query_route"), query_board_timer("query_board"),
         refund_ticket_timer("refund_ticket") {}
     ~TicketSystem() {}
 
@@ -107,18 +109,41 @@ class TicketSystem : command_helper, TrainSystem, UserSystem {
 
     void query_train() {
         query_train_timer.start();
+        if (arg('e') != nullptr) { // the stations, then "<date> <seats of each segment>" for each day
+            auto tmp = TrainSystem::query_train(arg('i'), arg('d'), arg('e'));
+            const Train *train = std::get<0>(tmp);
+            if (train == nullptr) {
+                puts("-1");
+            } else {
+                const int *seats = std::get<1>(tmp);
+                datetime_t date = std::get<2>(tmp);
+                int days = std::get<3>(tmp), segments = train->stationNum - 1;
+                printf("%s %c\n", train->trainID.c_str(), train->type);
+                for (int i = 0; i < train->stationNum; ++i) {
+                    printf(i ? " %s" : "%s", stationName(train->stations[i]).c_str());
+                }
+                putchar('\n');
+                for (int day = 0; day < days; ++day, date = date + 24 * 60) {
+                    printf("%s", date.toString().substr(0, 5).c_str());
+                    for (int j = 0; j < segments; ++j) printf(" %d", seats[day * segments + j]);
+                    putchar('\n');
+                }
+            }
+            query_train_timer.stop();
+            return;
+        }
         auto tmp = TrainSystem::query_train(arg('i'), arg('d'));
         if (std::get<0>(tmp) == nullptr) {
             puts("-1");
         } else {
-            Train *train = std::get<0>(tmp);
+            const Train *train = std::get<0>(tmp);
             int *seats = std::get<1>(tmp);
             datetime_t date = std::get<2>(tmp);
             printf("%s %c\n", train->trainID.c_str(), train->type);
             for (int i = 0; i < train->stationNum; ++i) {
                 datetime_t arri = (i == 0) ? 0 : date + train->arrivingTimes[i];
                 datetime_t leav = (i == train->stationNum - 1) ? 0 : date + train->leavingTimes[i];
-                printf("%s %s -> %s %d", train->stations[i].c_str(), arri.toString().c_str(), leav.toString().c_str(),
+                printf("%s %s -> %s %d", stationName(train->stations[i]).c_str(), arri.toString().c_str(), leav.toString().c_str(),
                        train->prices[i]);
                 if (i != train->stationNum - 1) {
                     printf(" %d\n", seats[i]);
@@ -131,10 +156,26 @@ class TicketSystem : command_helper, TrainSystem, UserSystem {
     }
 
     vector<TrainPreview> res;
+    vector<int> counts;
     void query_ticket() {
         query_ticket_timer.start();
         res.clear();
         res.reserve(1145);
+        if (arg('e') != nullptr) { // a line "<date> <count>" before the trains of each day
+            TrainSystem::query_ticket(res, counts, arg('s'), arg('t'), arg('d'), arg('e'), arg('p'));
+            datetime_t date(arg('d'), 1);
+            for (int day = 0, i = 0; day < counts.size(); ++day, date = date + 24 * 60) {
+                printf("%s %d\n", date.toString().substr(0, 5).c_str(), counts[day]);
+                for (int end = i + counts[day]; i < end; ++i) {
+                    printf("%s %s %s -> %s %s %d %d\n", res[i].trainID.c_str(), arg('s'),
+                           res[i].leavingTime.toString().c_str(), arg('t'), res[i].arrivingTime.toString().c_str(),
+                           res[i].price, res[i].seatCount);
+                }
+            }
+            if (counts.empty()) puts("0");
+            query_ticket_timer.stop();
+            return;
+        }
         TrainSystem::query_ticket(res, arg('s'), arg('t'), arg('d'), arg('p'));
         printf("%d\n", (int)res.size());
         for (int i = 0; i < res.size(); ++i) {
@@ -160,6 +201,46 @@ class TicketSystem : command_helper, TrainSystem, UserSystem {
         query_transfer_timer.stop();
     }
 
+    vector<RouteLeg> legs;
+    void query_route() {
+        query_route_timer.start();
+        legs.clear();
+        int tmp = TrainSystem::query_route(legs, arg('s'), arg('t'), arg('d'), arg('p'), arg('k'));
+        if (tmp == -1) {
+            puts("-1");
+        } else if (tmp == 0) {
+            puts("0");
+        }
+        for (int i = 0; i < legs.size(); ++i) {
+            printf("%s %s %s -> %s %s %d %d\n", legs[i].trainID.c_str(), stationName(legs[i].from).c_str(),
+                   legs[i].leavingTime.toString().c_str(), stationName(legs[i].to).c_str(),
+                   legs[i].arrivingTime.toString().c_str(), legs[i].price, legs[i].seatCount);
+        }
+        query_route_timer.stop();
+    }
+
+    // the number of trains, then for each train "<trainID> <-s> <LEAVING_TIME> <stops after -s>" and a
+    // line "<station> <ARRIVING_TIME> <PRICE> <SEAT>" for each stop after -s
+    vector<BoardTrain> boards;
+    vector<BoardStop> boardStops;
+    void query_board() {
+        query_board_timer.start();
+        boards.clear();
+        boardStops.clear();
+        TrainSystem::query_board(boards, boardStops, arg('s'), arg('d'));
+        printf("%d\n", (int)boards.size());
+        for (int i = 0; i < boards.size(); ++i) {
+            const BoardTrain &entry = boards[i];
+            printf("%s %s %s %d\n", entry.trainID.c_str(), arg('s'), entry.leavingTime.toString().c_str(), entry.stops);
+            for (int j = entry.first; j < entry.first + entry.stops; ++j) {
+                const BoardStop &stop = boardStops[j];
+                printf("%s %s %d %d\n", stationName(stop.station).c_str(), stop.arrivingTime.toString().c_str(),
+                       stop.price, stop.seatCount);
+            }
+        }
+        query_board_timer.stop();
+    }
+
     void buy_ticket() { // -u -i -d -n -f -t (-q false)
         buy_ticket_timer.start();
         if (UserSystem::isLogin(arg('u')) == false) {
@@ -194,8 +275,8 @@ class TicketSystem : command_helper, TrainSystem, UserSystem {
         printf("%d\n", (int)Orders.size());
         for (const auto &o : Orders) {
             printf("[%s] %s %s %s -> %s %s %d %d\n", orderState[o.state], o.trainID.c_str(),
-                   o.from.c_str(), o.getLeavingDatetime().toString().c_str(),
-                   o.to.c_str(), o.getArrivingDatetime().toString().c_str(), o.price, o.num);
+                   stationName(o.from).c_str(), o.getLeavingDatetime().toString().c_str(),
+                   stationName(o.to).c_str(), o.getArrivingDatetime().toString().c_str(), o.price, o.num);
         }
         query_order_timer.stop();
     }
@@ -234,6 +315,8 @@ class TicketSystem : command_helper, TrainSystem, UserSystem {
         case CMD::QT: query_train(); break;
         case CMD::QI: query_ticket(); break;
         case CMD::QR: query_transfer(); break;
+        case CMD::RO: query_route(); break;
+        case CMD::QB: query_board(); break;
         case CMD::BT: buy_ticket(); break;
         case CMD::QO: query_order(); break;
         case CMD::RI: refund_ticket(); break;
@@ -1,3 +1,6 @@
+#ifndef _TRAIN_HPP_
+#define _TRAIN_HPP_
+
 #include "String.hpp"
 #include "utility.hpp"
 #include "utils.hpp"
@@ -10,7 +13,7 @@ struct Train {
     number_t stationNum;
     number_t seatNum;
 
-    stationName_t stations[maxSTATION]; // 0 ~ stationNum - 1 
+    stationID_t stations[maxSTATION]; // 0 ~ stationNum - 1 
     price_t prices[maxSTATION]; // prefix sum of prices (0 ~ stationNum - 1)
 
     mytime_t arrivingTimes[maxSTATION]; 
@@ -31,7 +34,7 @@ struct Train {
         return salebeg + leavingTimes[0];
     }
 
-    pair<int, int> GetStationIndex(const stationName_t &beg, const stationName_t &end) const {
+    pair<int, int> GetStationIndex(stationID_t beg, stationID_t end) const {
         pair<int, int> res(-1, -1);
         for (int i = 0; i < stationNum; ++i) {
             if (stations[i] == beg) res.first = i;
@@ -39,9 +42,9 @@ struct Train {
         }
         return res;
     }
-    int GetStationIndex(const stationName_t &name) const {
+    int GetStationIndex(stationID_t id) const {
         for (int i = 0; i < stationNum; ++i) {
-            if (stations[i] == name) return i;
+            if (stations[i] == id) return i;
         }
         return -1;
     }
@@ -80,7 +83,8 @@ struct TrainLite {
     char salebegDD;
     char saleendDD;
     char pos; // 0 ~ stationNum - 1
-    bool checkdate(datetime_t date) {
+    char last; // 1 if the train ends at the station
+    bool checkdate(datetime_t date) const {
         return salebegDD <= date.getDDate() && date.getDDate() <= saleendDD;
     
     }
@@ -110,23 +114,61 @@ struct Transfer {
     }
 };
 
-struct TrainUnit {
+// a train through -t seen from one of its stations before -t (second leg of a transfer)
+struct TransferLeg {
     int trainIndex;
-    datetime_t date;
-    bool operator<(const TrainUnit &rhs) const {
-        return trainIndex != rhs.trainIndex ? trainIndex < rhs.trainIndex : date < rhs.date;
-    }
-    bool operator==(const TrainUnit &rhs) const {
-        return trainIndex == rhs.trainIndex && date == rhs.date;
-    }
+    int seatIndex;
+    int pos;          // index of the transfer station
+    int posT;         // index of -t
+    int startTime;    // leavingTimes[0]
+    int leavingTime;  // leavingTimes[pos]
+    int arrivingTime; // arrivingTimes[posT]
+    price_t price;    // prices[posT] - prices[pos]
+    datetime_t salebeg;
+    datetime_t saleend;
+    int next;         // next leg from the same station (1-based, 0 for none)
+};
 
+// the second legs starting from one station, with lower bounds of their ride time and price
+struct TransferStation {
+    int head;         // first TransferLeg (1-based, 0 for none)
+    int count;
+    int minRide;      // min of arrivingTime - leavingTime
+    price_t minPrice;
 };
 
+// a train leaving the station of query_board
+struct BoardTrain {
+    trainID_t trainID;
+    int trainIndex;
+    int seatIndex;
+    int pos;          // index of the station
+    datetime_t train_dep;
+    datetime_t leavingTime;
+    int first;        // its first BoardStop
+    int stops;        // number of stops after the station
+};
+
+// a stop after the station of query_board
+struct BoardStop {
+    stationID_t station;
+    datetime_t arrivingTime;
+    price_t price;    // from the station
+    number_t seatCount;
+};
 
-struct Seats {
-    seatinfo_t count[maxDURATION];
-}; // 36800 / 36864
+// one train ride of a query_route journey
+struct RouteLeg {
+    trainID_t trainID;
+    stationID_t from;
+    stationID_t to;
+    datetime_t leavingTime;
+    datetime_t arrivingTime;
+    price_t price;
+    number_t seatCount;
+};
 
 
+}
 
-}
\ No newline at end of file
+#endif // _TRAIN_HPP_
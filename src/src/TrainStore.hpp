@@ -0,0 +1,247 @@
+#ifndef _TRAIN_STORE_HPP_
+#define _TRAIN_STORE_HPP_
+
+#include "Vector.hpp"
+#include "File.hpp"
+#include "utils.hpp"
+#include "Train.hpp"
+#include "RouteTable.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace sjtu {
+
+// Train records of variable length: a fixed header with the route of the train, then stationNum
+// entries of each column, so a train with n stations takes 44 + 8n bytes instead of a 4 KB block.
+// The stations are kept once per route in a RouteTable. Records are appended back to back (several
+// trains share a page) and decoded into a Train on read.
+// Files: <name>.dat (records), <name>.vec (trainIndex -> offset, written on exit).
+// Records are never rewritten, so they are decoded in place from a read-only mapping of the file
+// (grown as trains are appended; if the file can not be mapped, the records are read into memory
+// instead), and the last CACHE_SIZE decoded trains are kept in a CLOCK cache; while nothing is
+// written, Readers on other threads use both without locks.
+class TrainStore {
+    struct header_t {
+        trainID_t trainID;
+        trainType_t type;
+        number_t stationNum;
+        number_t seatNum;
+        datetime_t salebeg;
+        datetime_t saleend;
+        int route;
+    };
+
+    static constexpr size_t MAX_RECORD = sizeof(header_t) + maxSTATION * (sizeof(price_t) + 2 * sizeof(mytime_t));
+
+    static constexpr int CACHE_SIZE = 1024;
+
+    RouteTable &routes;
+    std::string path;
+    std::fstream file; // appends
+    long long file_end;
+    const char *image = nullptr; // the mapped file, valid up to mapped_end
+    size_t image_size = 0;
+    long long mapped_end = 0;
+    bool mapped = true; // false once mmap failed, image is then copy
+    vector<char> copy;
+    VectorFile<long long> offsets; // trainIndex -> offset, index 0 is not a train
+    char buffer[MAX_RECORD];
+
+    Train *slots; // decoded trains
+    int owner[CACHE_SIZE] = {}; // slot -> trainIndex, 0 if empty
+    std::atomic<bool> referenced[CACHE_SIZE] = {}; // the CLOCK bits, set by hits on any thread
+    vector<int> slotOf; // trainIndex -> slot, -1 if not cached
+    int hand = 0;
+    size_t count_of_hit = 0;
+    size_t count_of_miss = 0;
+
+    template <class T>
+    static void put(char *&p, const T *src, int n) {
+        memcpy(p, src, n * sizeof(T));
+        p += n * sizeof(T);
+    }
+
+    template <class T>
+    static void get(const char *&p, T *dst, int n) {
+        memcpy(dst, p, n * sizeof(T));
+        p += n * sizeof(T);
+    }
+
+    size_t encode(const Train &train, char *buf) {
+        header_t h;
+        memset(&h, 0, sizeof(h));
+        h.trainID = train.trainID;
+        h.type = train.type;
+        h.stationNum = train.stationNum;
+        h.seatNum = train.seatNum;
+        h.salebeg = train.salebeg;
+        h.saleend = train.saleend;
+        h.route = routes.intern(train.stations, train.stationNum);
+        char *p = buf;
+        put(p, &h, 1);
+        put(p, train.prices, train.stationNum);
+        put(p, train.arrivingTimes, train.stationNum);
+        put(p, train.leavingTimes, train.stationNum);
+        return p - buf;
+    }
+
+    // makes the records up to file_end readable through image
+    void map() {
+        if (mapped_end == file_end) return;
+        file.flush();
+        if (mapped && size_t(file_end) > image_size) {
+            if (image != nullptr) munmap(const_cast<char *>(image), image_size);
+            image_size = 1 << 20;
+            while (image_size < size_t(file_end)) image_size <<= 1;
+            int fd = ::open(path.c_str(), O_RDONLY);
+            void *p = fd == -1 ? MAP_FAILED : mmap(nullptr, image_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (fd != -1) ::close(fd);
+            if (p == MAP_FAILED) {
+                fprintf(stderr, "TrainStore: can not map %s, reading it into memory\n", path.c_str());
+                mapped = false;
+                image = nullptr;
+                image_size = 0;
+                mapped_end = 0;
+            } else {
+                image = static_cast<const char *>(p);
+            }
+        }
+        if (!mapped) { // read the records appended since the last call
+            copy.resize(file_end);
+            file.clear();
+            file.seekg(mapped_end);
+            file.read(copy.data() + mapped_end, file_end - mapped_end);
+            image = copy.data();
+        }
+        mapped_end = file_end;
+    }
+
+    void decode(Train &train, int index) const {
+        const char *buf = image + offsets[index];
+        header_t h;
+        const char *p = buf;
+        get(p, &h, 1);
+        train.trainID = h.trainID;
+        train.type = h.type;
+        train.stationNum = h.stationNum;
+        train.seatNum = h.seatNum;
+        train.salebeg = h.salebeg;
+        train.saleend = h.saleend;
+        memcpy(train.stations, routes.stations(h.route), train.stationNum * sizeof(stationID_t));
+        get(p, train.prices, train.stationNum);
+        get(p, train.arrivingTimes, train.stationNum);
+        get(p, train.leavingTimes, train.stationNum);
+    }
+
+  public:
+    TrainStore(const std::string &name, RouteTable &routes) : routes(routes), path(name + ".dat"), offsets(name) {
+        file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!file.good()) {
+            file.close();
+            file.open(path, std::ios::out | std::ios::binary);
+            file.close();
+            file.open(path, std::ios::in | std::ios::out | std::ios::binary);
+        }
+        file.seekp(0, std::ios::end);
+        file_end = file.tellp();
+        if (offsets.empty()) offsets.push_back(0);
+        slots = new Train[CACHE_SIZE];
+        slotOf.resize(offsets.size());
+        for (size_t i = 0; i < slotOf.size(); ++i) slotOf[i] = -1;
+    }
+
+    ~TrainStore() {
+        delete[] slots;
+        if (mapped && image != nullptr) munmap(const_cast<char *>(image), image_size);
+#ifdef DEBUG
+        fprintf(stderr, "TrainsData %zu trains on %d routes, cache %zu hits, %zu misses\n", offsets.size() - 1,
+                routes.size(), count_of_hit, count_of_miss);
+#endif
+    }
+
+    TrainStore(const TrainStore &) = delete;
+    TrainStore &operator=(const TrainStore &) = delete;
+
+    // appends a train, returns its trainIndex
+    int write(const Train &train) {
+        size_t size = encode(train, buffer);
+        file.clear();
+        file.seekp(file_end);
+        file.write(buffer, size);
+        offsets.push_back(file_end);
+        slotOf.push_back(-1);
+        file_end += size;
+        return offsets.size() - 1;
+    }
+
+    // the train of an index, valid until the next get()
+    const Train &get(int index) {
+        int slot = slotOf[index];
+        if (slot != -1) {
+            ++count_of_hit;
+            referenced[slot].store(true, std::memory_order_relaxed);
+            return slots[slot];
+        }
+        ++count_of_miss;
+        while (referenced[hand].load(std::memory_order_relaxed)) {
+            referenced[hand].store(false, std::memory_order_relaxed);
+            hand = (hand + 1) % CACHE_SIZE;
+        }
+        slot = hand;
+        hand = (hand + 1) % CACHE_SIZE;
+        if (owner[slot]) slotOf[owner[slot]] = -1;
+        owner[slot] = index;
+        slotOf[index] = slot;
+        map();
+        decode(slots[slot], index);
+        return slots[slot];
+    }
+
+    // maps appended trains, so that Readers see them
+    void flush() {
+        map();
+    }
+
+    // a read-only view of the store for another thread, valid while no train is written and
+    // nothing calls get(); misses are decoded into the Reader's own train and not cached
+    class Reader {
+        TrainStore *store = nullptr;
+        Train train;
+        size_t count_of_hit = 0;
+        size_t count_of_miss = 0;
+
+      public:
+        ~Reader() {
+            if (store == nullptr) return;
+            store->count_of_hit += count_of_hit;
+            store->count_of_miss += count_of_miss;
+        }
+
+        void open(TrainStore &owner) {
+            store = &owner;
+        }
+
+        // the train of an index, valid until the next get()
+        const Train &get(int index) {
+            int slot = store->slotOf[index];
+            if (slot != -1) {
+                ++count_of_hit;
+                store->referenced[slot].store(true, std::memory_order_relaxed);
+                return store->slots[slot];
+            }
+            ++count_of_miss;
+            store->decode(train, index);
+            return train;
+        }
+    };
+};
+
+} // namespace sjtu
+
+#endif // _TRAIN_STORE_HPP_
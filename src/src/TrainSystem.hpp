@@ -8,45 +8,240 @@
 #include "User.hpp"
 #include "File.hpp"
 #include "BPlusTree.hpp"
+#include "HashIndex.hpp"
+#include "ThreadPool.hpp"
+#include "StationPostings.hpp"
+#include "SeatInventory.hpp"
+#include "Waitlist.hpp"
+#include "StationDict.hpp"
+#include "RouteTable.hpp"
+#include "TrainStore.hpp"
 #include "Vector.hpp"
 #include <cassert>
 #include <iterator>
 #include <tuple>
 
+// layout of SeatsData.dat, see SeatInventory (1: rows clustered by day)
+#ifndef SEAT_DATE_MAJOR
+#define SEAT_DATE_MAJOR 0
+#endif
+
 namespace sjtu {
 
 class TrainSystem {
     // BPlusTree<trainID_t, TrainState> TrainsStates; // trainID -> TrainState
 
-    BPlusTree<size_t, TrainState> TrainsStates; // trainID_hash -> TrainState
+    HashIndex<size_t, TrainState, 4096, 1000, 10> TrainsStates; // trainID_hash -> TrainState (Bloom filtered)
 
-    DataFile<Train> TrainsData; // TrainIndex -> Train
-    DataFile<Seats> SeatsData;  // SeatIndex -> Seats
-    BPlusTree<pair<size_t, int>, TrainLite, 4096 * 2> StationMap;  // stationName_hash -> TrainLite
-    BPlusTree<pair<TrainUnit, int>, int, 4096 * 2, 20000> TrainUnitMap; // TrainUnit -> OrderIndex
+    RouteTable Routes; // station sequence <-> route id
+    TrainStore TrainsData; // TrainIndex -> Train
+    SeatInventory<SEAT_DATE_MAJOR> TrainSeats; // SeatIndex -> seats left of each day
+    StationDict Stations; // station name <-> station id
+    StationPostings StationLists; // station id -> released trains through it (in memory)
+    Waitlist PendingOrders; // (trainIndex, day) -> pending orders (in memory)
     DataFile<Order, sizeof(Order)> OrdersData; // OrderIndex -> Order
     VectorFile<trainID_t> TrainIDArray; // TrainIndex -> TrainID
 
     Train tmpTrain;
-    Seats tmpSeats;
+    seatinfo_t tmpSeatRow;
+    vector<int> calendar; // days * segments seats of query_train -e
+    vector<SeatQuery> seatBatch;
+    vector<int> boardSeats; // the seats to each stop of query_board
     Transfer tmpTransfer;
     Order tmpOrder;
+    Hashmap<size_t, TransferStation, 1024> transferStations; // station id -> second legs from there
+    vector<TransferLeg> transferLegs;
+    size_t count_of_transfer_evaluated = 0; // candidates compared with the best transfer
+    size_t count_of_transfer_pruned = 0;    // candidates skipped by the lower bounds
+    size_t count_of_ticket_query = 0;
+    size_t count_of_ticket_seat_read = 0;   // reads of the batched seat rows of query_ticket
+
+    // a transfer found by query_transfer, seats are filled in for the winner only
+    struct TransferCandidate {
+        int trainIndex1, trainIndex2, seatIndex1, seatIndex2;
+        int beg, mid, pos2, posT; // station indexes: -s and mid in train 1, mid and -t in train 2
+        datetime_t train1_dep, train2_dep;
+        datetime_t leavingTime1, arrivingTime1, leavingTime2, arrivingTime2;
+        int price1, price2;
+        int cost() const {
+            return price1 + price2;
+        }
+        int times() const {
+            return arrivingTime2 - leavingTime1;
+        }
+    };
+
+    // per-thread state of query_transfer
+    struct TransferWorker {
+        TrainStore::Reader reader; // TrainsData
+        TransferCandidate best, cur;
+        stationID_t mid;
+        bool found = false;
+        size_t evaluated = 0;
+        size_t pruned = 0;
+    };
+
+    static constexpr int TRANSFER_PARALLEL_MIN = 32; // fewer first legs are probed on the calling thread
+
+    // query_transfer result without seats, valid while no train is released
+    struct TransferCacheEntry {
+        stationID_t s, t;
+        int date;
+        bool byCost;
+        size_t epoch;
+        bool found;
+        TransferCandidate best;
+        stationID_t mid;
+    };
+
+    static constexpr int TRANSFER_CACHE_SIZE = 1 << 16; // the cache is emptied when it grows beyond this
+
+    Hashmap<size_t, TransferCacheEntry, 1024> transferCache; // (s, t, date, -p) -> route
+    size_t releaseEpoch = 0; // incremented by release_train, older cache entries are stale
+    size_t count_of_transfer_cache_hit = 0;
+    size_t count_of_transfer_cache_miss = 0;
+
+    // a journey of query_route up to one train ride, the rides before it are reached through parent
+    struct RouteLabel {
+        int parent;          // the label of the previous ride, -1 for the first ride
+        int legs;
+        int trainIndex, seatIndex;
+        int boardPos, alightPos;
+        stationID_t station; // where the ride ends
+        datetime_t train_dep;
+        datetime_t dep;      // leaving -s
+        datetime_t leavingTime, arrivingTime;
+        int price;           // of this ride
+        int cost;            // of the journey
+        bool alive;          // not dominated by a later label of the same round
+        int nextInBag;       // next label of the same round, station and train (-1 for none)
+        int times() const {
+            return arrivingTime - dep;
+        }
+    };
+
+    // a label of the previous round waiting for the train being scanned
+    struct RouteBoarding {
+        int label;
+        int pos;
+        datetime_t train_dep;
+    };
+
+    static constexpr int ROUTE_MAX_TRANSFERS = 3;
+
+    vector<RouteLabel> routeLabels;
+    Hashmap<size_t, int, 1024> routeBags[2];     // (station, train) -> labels of a round, by round parity
+    vector<int> routeRound[2];                   // the labels left of a round by station, then time or cost
+    Hashmap<size_t, int, 1024> routeStations[2]; // station -> its first label in routeRound
+    Hashmap<size_t, int, 1024> routeTrains;      // trains scanned by a round
+    vector<RouteBoarding> routeBoarding;
+    size_t count_of_route_label = 0;
+    size_t count_of_route_dominated = 0;
+
+    ThreadPool transferPool;
+    TransferWorker *transferWorkers;
 
-    void readSeats(Seats &seats, int seatIndex, int date) {
-        SeatsData.read(seats, seatIndex, date * sizeof(seatinfo_t), sizeof(seatinfo_t));
+    static int transferThreads() {
+        int n = std::thread::hardware_concurrency();
+        return n < 1 ? 1 : (n > 8 ? 8 : n);
     }
-    void writeSeats(Seats &seats, int seatIndex, int date) {
-        SeatsData.update(seats, seatIndex, date * sizeof(seatinfo_t), sizeof(seatinfo_t));
+
+    // time or cost, then trainID1, then trainID2
+    bool transferBetter(const TransferCandidate &a, const TransferCandidate &b, bool byCost) {
+        if (byCost) {
+            if (a.cost() != b.cost()) return a.cost() < b.cost();
+            if (a.times() != b.times()) return a.times() < b.times();
+        } else {
+            if (a.times() != b.times()) return a.times() < b.times();
+            if (a.cost() != b.cost()) return a.cost() < b.cost();
+        }
+        if (a.trainIndex1 != b.trainIndex1) return TrainIDArray[a.trainIndex1] < TrainIDArray[b.trainIndex1];
+        return TrainIDArray[a.trainIndex2] < TrainIDArray[b.trainIndex2];
+    }
+
+    // walk one first leg of query_transfer and probe the second legs from each later station,
+    // only reads shared state (transferStations, transferLegs, TrainIDArray), may run on any worker
+    void probeTransfer(TransferWorker &worker, const TrainLite &index, datetime_t departingDate,
+                       stationID_t to, bool byCost) {
+        datetime_t train1_dep = (departingDate - index.leavingTimes);
+        train1_dep.remainDate();
+        if (!index.checkdate(train1_dep)) return;
+        TransferCandidate &cur = worker.cur, &best = worker.best;
+        const Train &train = worker.reader.get(index.trainIndex);
+        cur.trainIndex1 = index.trainIndex;
+        cur.seatIndex1 = index.seatIndex;
+        cur.beg = index.pos;
+        cur.train1_dep = train1_dep;
+        cur.leavingTime1 = train1_dep + index.leavingTimes;
+        for (int i = index.pos + 1; i < train.stationNum; ++i) {
+            if (train.stations[i] == to) continue;
+            if (!transferStations.count(train.stations[i])) continue;
+            const TransferStation &station = transferStations.at(train.stations[i]);
+            cur.mid = i;
+            cur.arrivingTime1 = train1_dep + train.arrivingTimes[i];
+            cur.price1 = train.prices[i] - train.prices[index.pos];
+            int ride1 = cur.arrivingTime1 - cur.leavingTime1;
+            if (worker.found && (byCost ? cur.price1 + station.minPrice > best.cost() :
+                                 ride1 + station.minRide > best.times())) {
+                worker.pruned += station.count;
+                continue;
+            }
+            for (int j = station.head; j; j = transferLegs[j - 1].next) {
+                const TransferLeg &leg = transferLegs[j - 1];
+                if (leg.trainIndex == index.trainIndex) continue;
+                if (worker.found && (byCost ? cur.price1 + leg.price > best.cost() :
+                                     ride1 + leg.arrivingTime - leg.leavingTime > best.times())) {
+                    ++worker.pruned;
+                    continue;
+                }
+                ++worker.evaluated;
+                datetime_t train2_dep = (cur.arrivingTime1 - (leg.leavingTime - leg.startTime));
+                if (leg.saleend + leg.startTime < train2_dep) continue;
+                if (train2_dep < leg.salebeg + leg.startTime) {
+                    train2_dep = leg.salebeg;
+                } else {
+                    if (train2_dep.getTime() > leg.startTime) {
+                        train2_dep = train2_dep + 24 * 60;
+                    }
+                    train2_dep.remainDate();
+                }
+                cur.trainIndex2 = leg.trainIndex;
+                cur.seatIndex2 = leg.seatIndex;
+                cur.pos2 = leg.pos;
+                cur.posT = leg.posT;
+                cur.train2_dep = train2_dep;
+                cur.leavingTime2 = train2_dep + leg.leavingTime;
+                cur.arrivingTime2 = train2_dep + leg.arrivingTime;
+                cur.price2 = leg.price;
+                if (!worker.found || transferBetter(cur, best, byCost)) {
+                    worker.found = true;
+                    best = cur;
+                    worker.mid = train.stations[i];
+                }
+            }
+        }
     }
 
   public:
-    TrainSystem() : TrainsStates("TrainsState"), SeatsData("SeatsData"),
-        TrainsData("TrainsData"), StationMap("StationMap"), OrdersData("OrdersData"), TrainUnitMap("TrainUnitMap"),
-        TrainIDArray("TrainIDArray") {
+    TrainSystem() : TrainsStates("TrainsState"), TrainSeats("Seats"),
+        Routes("Route"), TrainsData("TrainsData", Routes), Stations("StationNames"), StationLists("StationPostings"), OrdersData("OrdersData"), PendingOrders("Waitlist"),
+        TrainIDArray("TrainIDArray"), transferPool(transferThreads()) {
         if (TrainIDArray.empty()) TrainIDArray.push_back("");
+        transferWorkers = new TransferWorker[transferPool.size()];
+        for (int w = 0; w < transferPool.size(); ++w) transferWorkers[w].reader.open(TrainsData);
     }
 
     ~TrainSystem() {
+        delete[] transferWorkers;
+#ifdef DEBUG
+        fprintf(stderr, "query_transfer evaluated %zu candidates, pruned %zu\n", count_of_transfer_evaluated,
+                count_of_transfer_pruned);
+        fprintf(stderr, "query_transfer cache %zu hits, %zu misses\n", count_of_transfer_cache_hit,
+                count_of_transfer_cache_miss);
+        fprintf(stderr, "query_ticket %zu queries, %zu seat reads\n", count_of_ticket_query,
+                count_of_ticket_seat_read);
+        fprintf(stderr, "query_route %zu labels, %zu dominated\n", count_of_route_label, count_of_route_dominated);
+#endif
     }
 
     // [N] add_train -i -n -m -s -p -x -t -o -d -y
@@ -58,7 +253,9 @@ class TrainSystem {
         tmpTrain.trainID = _i;
         tmpTrain.stationNum = atoi(_n);
         tmpTrain.seatNum = atoi(_m);
-        getStrings(tmpTrain.stations, _s);
+        stationName_t names[maxSTATION];
+        getStrings(names, _s);
+        for (int i = 0; i < tmpTrain.stationNum; ++i) tmpTrain.stations[i] = Stations.intern(names[i]);
         getIntegers(tmpTrain.prices + 1, _p);
         tmpTrain.leavingTimes[0] = datetime_t(_x, 2).getTime();
         getIntegers(tmpTrain.arrivingTimes + 1, _t);
@@ -96,191 +293,587 @@ class TrainSystem {
         auto tmp = TrainsStates.find(hash_i);
         if (tmp.second == false) return 0;
         if (tmp.first.isReleased()) return 0;
-        TrainsData.read(tmpTrain, tmp.first.trainIndex);
+        const Train &train = TrainsData.get(tmp.first.trainIndex);
         tmp.first.state = 1;
-        for (datetime_t i = tmpTrain.salebeg; i <= tmpTrain.saleend; i = i + 1) {
-            for (int j = 0; j < tmpTrain.stationNum - 1; ++j) {
-                tmpSeats.count[i.getDDate()][j] = tmpTrain.seatNum;
-            }
-        }
-        tmp.first.seatIndex = SeatsData.write(tmpSeats);
+        ++releaseEpoch; // new trains may change any transfer route
+        tmp.first.seatIndex = TrainSeats.create(train);
         TrainsStates.modify(hash_i, tmp.first);
-        // Puting the train into the StationMap
+        // Puting the train into the station lists
         TrainLite lite; lite.trainIndex = tmp.first.trainIndex; lite.seatIndex = tmp.first.seatIndex;
-        lite.salebegDD = tmpTrain.salebeg.getDDate(); lite.saleendDD = tmpTrain.saleend.getDDate();
-        for (int i = 0; i < tmpTrain.stationNum; ++i) {
-            lite.price = tmpTrain.prices[i];
-            lite.leavingTimes = tmpTrain.leavingTimes[i];
-            lite.arrivingTimes = tmpTrain.arrivingTimes[i];
+        lite.salebegDD = train.salebeg.getDDate(); lite.saleendDD = train.saleend.getDDate();
+        for (int i = 0; i < train.stationNum; ++i) {
+            lite.price = train.prices[i];
+            lite.leavingTimes = train.leavingTimes[i];
+            lite.arrivingTimes = train.arrivingTimes[i];
             lite.pos = i;
-            StationMap.insert(pair(string_hash(tmpTrain.stations[i]), tmp.first.trainIndex), lite);
+            lite.last = i == train.stationNum - 1;
+            StationLists.insert(train.stations[i], lite);
         }
         // TODO : release train !!! OKOKOKOKOK
         return 1;
     }
 
     // [N] query_train -i -d
-    std::tuple<Train *, int *, datetime_t> query_train(const char *_i, const char *_d) {
+    std::tuple<const Train *, int *, datetime_t> query_train(const char *_i, const char *_d) {
         size_t hash_i = string_hash(_i);
         auto tmp = TrainsStates.find(hash_i);
         if (tmp.second == false) {
             CERR("train %s not exist\n", _i);
             return std::make_tuple(nullptr, nullptr, 0);
         }
-        TrainsData.read(tmpTrain, tmp.first.trainIndex);
+        const Train &train = TrainsData.get(tmp.first.trainIndex);
         datetime_t departingDate = datetime_t(_d, 1);
-        if (!tmpTrain.checkdate(departingDate)) {
-            CERR("%s %s\n", tmpTrain.salebeg.toString().c_str(), tmpTrain.saleend.toString().c_str());
+        if (!train.checkdate(departingDate)) {
+            CERR("%s %s\n", train.salebeg.toString().c_str(), train.saleend.toString().c_str());
             CERR("date %s not in range\n", _d);
             return std::make_tuple(nullptr, nullptr, 0);
         }
         if (tmp.first.isReleased()) {
-            readSeats(tmpSeats, tmp.first.seatIndex, departingDate.getDDate());
+            TrainSeats.get(tmp.first.seatIndex, departingDate.getDDate(), tmpSeatRow);
         } else {
-            for (int j = 0; j < tmpTrain.stationNum - 1; ++j) {
-                tmpSeats.count[departingDate.getDDate()][j] = tmpTrain.seatNum;
+            for (int j = 0; j < train.stationNum - 1; ++j) {
+                tmpSeatRow[j] = train.seatNum;
             }
         }
-        return std::make_tuple(&tmpTrain, tmpSeats.count[departingDate.getDDate()], departingDate);
+        return std::make_tuple(&train, tmpSeatRow, departingDate);
+    }
+
+    // [N] query_train -i -d -e
+    // the seats of every segment on every day from -d to -e within the sale, row after row; the
+    // rows of a released train are fetched by one call into the inventory
+    std::tuple<const Train *, const int *, datetime_t, int> query_train(const char *_i, const char *_d,
+                                                                        const char *_e) {
+        size_t hash_i = string_hash(_i);
+        auto tmp = TrainsStates.find(hash_i);
+        if (tmp.second == false) return std::make_tuple(nullptr, nullptr, 0, 0);
+        const Train &train = TrainsData.get(tmp.first.trainIndex);
+        datetime_t first = datetime_t(_d, 1), last = datetime_t(_e, 1);
+        if (first < train.salebeg) first = train.salebeg;
+        if (train.saleend < last) last = train.saleend;
+        if (last < first) return std::make_tuple(nullptr, nullptr, 0, 0);
+        int days = last.getDDate() - first.getDDate() + 1, segments = train.stationNum - 1;
+        calendar.resize(days * segments);
+        if (tmp.first.isReleased()) {
+            TrainSeats.get(tmp.first.seatIndex, first.getDDate(), days, calendar.data());
+        } else {
+            for (int i = 0; i < days * segments; ++i) calendar[i] = train.seatNum;
+        }
+        return std::make_tuple(&train, calendar.data(), first, days);
     }
 
 
     // [SF] query_ticket -s -t -d (-p time)
+    // intersects the in-memory station lists of -s and -t, only the seat counts are read from disk
     void query_ticket(vector<TrainPreview> &res, const char *_s, const char *_t, const char *_d, const char *_p) {
         datetime_t departingDate = datetime_t(_d, 1) + datetime_t("23:59", 2);
-        vector<TrainLite> indexs;
-        vector<TrainLite> indext;
-        auto hash_s = string_hash(_s);
-        auto hash_t = string_hash(_t);
-        StationMap.search(pair(hash_s, 0), pair(hash_s, 0x3f3f3f3f), indexs);
-        StationMap.search(pair(hash_t, 0), pair(hash_t, 0x3f3f3f3f), indext);
-        auto it = indexs.begin();
-        auto jt = indext.begin();
-        while (it != indexs.end() && jt != indext.end()) {
-            if (it->trainIndex < jt->trainIndex) {
-                ++it;
-            } else if (it->trainIndex > jt->trainIndex) {
-                ++jt;
-            } else {
-                if (it->leavingTimes < jt->leavingTimes) {
-                    datetime_t train_dep = (departingDate - it->leavingTimes);
-                    train_dep.remainDate();
-                    if (it->checkdate(train_dep)) {
-                        TrainPreview tmp;
-                        tmp.trainID = TrainIDArray[it->trainIndex];
-                        tmp.leavingTime = train_dep + it->leavingTimes;
-                        tmp.arrivingTime = train_dep + jt->arrivingTimes;
-                        tmp.price = jt->price - it->price;
-                        readSeats(tmpSeats, it->seatIndex, train_dep.getDDate());
-                        tmp.seatCount = 0x3f3f3f3f;
-                        for (int i = it->pos; i < jt->pos; ++i) {
-                            tmp.seatCount = std::min(tmp.seatCount, tmpSeats.count[train_dep.getDDate()][i]);
-                        }
-                        res.push_back(tmp);
-                    }
-                }
-                ++it, ++jt;
+        const StationPostingList &ls = StationLists.find(Stations.find(_s));
+        const StationPostingList &lt = StationLists.find(Stations.find(_t));
+        int base = res.size();
+        seatBatch.clear();
+        StationPostings::intersect(ls, lt, [&](int i, int j) {
+            if (ls.leavingTimes[i] >= lt.leavingTimes[j]) return;
+            datetime_t train_dep = (departingDate - ls.leavingTimes[i]);
+            train_dep.remainDate();
+            if (train_dep.getDDate() < ls.salebegDD[i] || ls.saleendDD[i] < train_dep.getDDate()) return;
+            TrainPreview tmp;
+            tmp.trainID = TrainIDArray[ls.trainIndex[i]];
+            tmp.leavingTime = train_dep + ls.leavingTimes[i];
+            tmp.arrivingTime = train_dep + lt.arrivingTimes[j];
+            tmp.price = lt.price[j] - ls.price[i];
+            res.push_back(tmp);
+            seatBatch.push_back(SeatQuery{ls.seatIndex[i], train_dep.getDDate(), ls.pos[i], lt.pos[j], 0});
+        });
+        // the seat rows of all the trains are fetched in one batch
+        int reads = TrainSeats.query(seatBatch);
+        ++count_of_ticket_query;
+        count_of_ticket_seat_read += reads;
+        CERR("query_ticket: %d trains, %d seat reads\n", (int)seatBatch.size(), reads);
+        for (int i = 0; i < seatBatch.size(); ++i) res[base + i].seatCount = seatBatch[i].seats;
+        sortPreviews(res.begin(), res.end(), _p);
+    }
+
+    // [N] query_board -s -d
+    // the released trains leaving -s on -d by leaving time, then trainID, with their stops after -s:
+    // one scan of the station list of -s, then the trains left are read for their stops and the
+    // seats to every stop are fetched in one batch
+    void query_board(vector<BoardTrain> &res, vector<BoardStop> &stops, const char *_s, const char *_d) {
+        datetime_t departingDate = datetime_t(_d, 1) + datetime_t("23:59", 2);
+        const StationPostingList &ls = StationLists.find(Stations.find(_s));
+        for (size_t i = 0; i < ls.size(); ++i) {
+            if (ls.last[i]) continue; // ends at -s
+            datetime_t train_dep = (departingDate - ls.leavingTimes[i]);
+            train_dep.remainDate();
+            if (train_dep.getDDate() < ls.salebegDD[i] || ls.saleendDD[i] < train_dep.getDDate()) continue;
+            BoardTrain tmp;
+            tmp.trainID = TrainIDArray[ls.trainIndex[i]];
+            tmp.trainIndex = ls.trainIndex[i];
+            tmp.seatIndex = ls.seatIndex[i];
+            tmp.pos = ls.pos[i];
+            tmp.train_dep = train_dep;
+            tmp.leavingTime = train_dep + ls.leavingTimes[i];
+            res.push_back(tmp);
+        }
+        sort(res.begin(), res.end(), [&](const BoardTrain & a, const BoardTrain & b) {
+            return a.leavingTime != b.leavingTime ? a.leavingTime < b.leavingTime : a.trainID < b.trainID;
+        });
+        for (int k = 0; k < res.size(); ++k) {
+            BoardTrain &entry = res[k];
+            const Train &train = TrainsData.get(entry.trainIndex);
+            entry.first = stops.size();
+            entry.stops = train.stationNum - 1 - entry.pos;
+            for (int j = entry.pos + 1; j < train.stationNum; ++j) {
+                stops.push_back(BoardStop{train.stations[j], entry.train_dep + train.arrivingTimes[j],
+                                          train.prices[j] - train.prices[entry.pos], 0});
             }
         }
+        // one seat query per train, filling the seats to each of its stops
+        boardSeats.resize(stops.size());
+        seatBatch.clear();
+        for (int k = 0; k < res.size(); ++k) {
+            const BoardTrain &entry = res[k];
+            seatBatch.push_back(SeatQuery{entry.seatIndex, entry.train_dep.getDDate(), entry.pos,
+                                          entry.pos + entry.stops, 0, boardSeats.data() + entry.first});
+        }
+        TrainSeats.query(seatBatch);
+        for (int i = 0; i < stops.size(); ++i) stops[i].seatCount = boardSeats[i];
+    }
+
+    // the order of query_ticket: by -p time (default) or cost, then trainID
+    template <class Iterator>
+    static void sortPreviews(Iterator first, Iterator last, const char *_p) {
         if (_p != nullptr && _p[0] == 'c') { // by cost
-            sort(res.begin(), res.end(), [&](const TrainPreview & a, const TrainPreview & b) {
+            sort(first, last, [&](const TrainPreview & a, const TrainPreview & b) {
                 return a.price != b.price ? a.price < b.price : a.trainID < b.trainID;
             });
         } else { // by time
-            sort(res.begin(), res.end(), [&](const TrainPreview & a, const TrainPreview & b) {
+            sort(first, last, [&](const TrainPreview & a, const TrainPreview & b) {
                 return (a.arrivingTime - a.leavingTime) != (b.arrivingTime - b.leavingTime) ?
                        (a.arrivingTime - a.leavingTime) < (b.arrivingTime - b.leavingTime) : a.trainID < b.trainID;
             });
         }
     }
 
+    // [SF] query_ticket -s -t -d -e (-p time)
+    // query_ticket of every day from -d to -e: the station lists are intersected once, then each
+    // train is tried on every day, its seat rows of the days are queried together so that they
+    // coalesce into one read; res holds the days in order, counts[day] trains each
+    void query_ticket(vector<TrainPreview> &res, vector<int> &counts, const char *_s, const char *_t,
+                      const char *_d, const char *_e, const char *_p) {
+        datetime_t firstDate = datetime_t(_d, 1) + datetime_t("23:59", 2);
+        int days = (datetime_t(_e, 1) - datetime_t(_d, 1)) / (24 * 60) + 1;
+        if (days > maxDURATION) days = maxDURATION;
+        counts.clear();
+        for (int day = 0; day < days; ++day) counts.push_back(0);
+        if (days <= 0) return;
+        const StationPostingList &ls = StationLists.find(Stations.find(_s));
+        const StationPostingList &lt = StationLists.find(Stations.find(_t));
+        vector<TrainPreview> found;
+        vector<int> foundDay;
+        seatBatch.clear();
+        StationPostings::intersect(ls, lt, [&](int i, int j) {
+            if (ls.leavingTimes[i] >= lt.leavingTimes[j]) return;
+            for (int day = 0; day < days; ++day) {
+                datetime_t train_dep = (firstDate + day * 24 * 60 - ls.leavingTimes[i]);
+                train_dep.remainDate();
+                if (train_dep.getDDate() < ls.salebegDD[i] || ls.saleendDD[i] < train_dep.getDDate()) continue;
+                TrainPreview tmp;
+                tmp.trainID = TrainIDArray[ls.trainIndex[i]];
+                tmp.leavingTime = train_dep + ls.leavingTimes[i];
+                tmp.arrivingTime = train_dep + lt.arrivingTimes[j];
+                tmp.price = lt.price[j] - ls.price[i];
+                found.push_back(tmp);
+                foundDay.push_back(day);
+                ++counts[day];
+                seatBatch.push_back(SeatQuery{ls.seatIndex[i], train_dep.getDDate(), ls.pos[i], lt.pos[j], 0});
+            }
+        });
+        int reads = TrainSeats.query(seatBatch);
+        count_of_ticket_query += days;
+        count_of_ticket_seat_read += reads;
+        CERR("query_ticket: %d days, %d trains, %d seat reads\n", days, (int)seatBatch.size(), reads);
+        // group by day
+        vector<int> offset;
+        offset.push_back(res.size());
+        for (int day = 0; day < days; ++day) offset.push_back(offset[day] + counts[day]);
+        res.resize(offset[days]);
+        for (int i = 0; i < found.size(); ++i) {
+            found[i].seatCount = seatBatch[i].seats;
+            res[offset[foundDay[i]]++] = found[i];
+        }
+        for (int day = 0; day < days; ++day) sortPreviews(res.begin() + (offset[day] - counts[day]), res.begin() + offset[day], _p);
+    }
+
     // [N] query_transfer -s -t -d (-p time)
+    // hash join: the trains through -t are read once to build station -> second legs, then the
+    // stations after -s on the trains through -s probe it; seats are only read for the winner.
+    // Candidates whose lower bound (time or cost) is already worse than the best are skipped.
+    // The first legs are split across the worker pool, each worker keeps its own best.
+    // Routes are cached per (s, t, date, -p) until the next release, a hit only reads the seats.
     Transfer *query_transfer(const char *_s, const char *_t, const char *_d, const char *_p) {
         datetime_t departingDate = datetime_t(_d, 1) + datetime_t("23:59", 2);
-        tmpTransfer.mid = "";
+        stationID_t s = Stations.find(_s), t = Stations.find(_t);
+        if (s == -1 || t == -1) return nullptr;
+        bool byCost = _p != nullptr && _p[0] == 'c';
+        size_t key = (size_t(s) << 40 | size_t(t) << 20) ^ (size_t(departingDate.value) << 1 | byCost);
+        if (transferCache.count(key)) {
+            TransferCacheEntry &entry = transferCache.at(key);
+            if (entry.epoch == releaseEpoch && entry.s == s && entry.t == t &&
+                entry.date == departingDate.value && entry.byCost == byCost) {
+                ++count_of_transfer_cache_hit;
+                if (!entry.found) return nullptr;
+                return fillTransfer(entry.best, entry.mid, _s, _t);
+            }
+        }
+        ++count_of_transfer_cache_miss;
+        if (transferCache.size() >= TRANSFER_CACHE_SIZE) transferCache.clear();
+        TransferCacheEntry &entry = transferCache[key];
+        entry.s = s;
+        entry.t = t;
+        entry.date = departingDate.value;
+        entry.byCost = byCost;
+        entry.epoch = releaseEpoch;
+        entry.found = false;
+        const StationPostingList &ls = StationLists.find(s);
+        const StationPostingList &lt = StationLists.find(t);
+        if (ls.size() == 0 || lt.size() == 0) return nullptr;
         vector<TrainLite> indexs;
-        vector<TrainLite> indexs2;
-        Train tmpTrain2;
-        Seats tmpSeats2;
-        Transfer tttt;
-        tttt.from = _s;
-        tttt.to = _t;
-        auto hash_s = string_hash(_s);
-        StationMap.search(pair(hash_s, 0), pair(hash_s, 0x3f3f3f3f), indexs);
-        for (auto index : indexs) {
-            TrainsData.read(tmpTrain, index.trainIndex);
-            int begIndex = tmpTrain.GetStationIndex(_s);
-            if (begIndex == -1) continue;
-            datetime_t train1_dep = (departingDate - tmpTrain.leavingTimes[begIndex]);
-            train1_dep.remainDate();
-            if (!tmpTrain.checkdate(train1_dep)) continue;
-            tttt.trainID1 = tmpTrain.trainID;
-            tttt.leavingTime1 = train1_dep + tmpTrain.leavingTimes[begIndex];
-            for (int i = begIndex + 1; i < tmpTrain.stationNum; ++i) {
-                if (tmpTrain.stations[i] == _t) continue;
-                tttt.arrivingTime1 = train1_dep + tmpTrain.arrivingTimes[i];
-                // CERR("tttt.arrivingTime1 = %s\n", tttt.arrivingTime1.toString().c_str());
-                tttt.price1 = tmpTrain.prices[i] - tmpTrain.prices[begIndex];
-                readSeats(tmpSeats, index.seatIndex, train1_dep.getDDate());
-                tttt.seatCount1 = 0x3f3f3f3f;
-                for (int j = begIndex; j < i; ++j) {
-                    tttt.seatCount1 = std::min(tttt.seatCount1, tmpSeats.count[train1_dep.getDDate()][j]);
+        vector<TrainLite> indext;
+        for (size_t i = 0; i < ls.size(); ++i) indexs.push_back(ls.at(i));
+        for (size_t i = 0; i < lt.size(); ++i) indext.push_back(lt.at(i));
+        // build
+        transferStations.clear();
+        transferLegs.clear();
+        for (auto index : indext) {
+            const Train &train = TrainsData.get(index.trainIndex);
+            TransferLeg leg;
+            leg.trainIndex = index.trainIndex;
+            leg.seatIndex = index.seatIndex;
+            leg.posT = index.pos;
+            leg.startTime = train.leavingTimes[0];
+            leg.arrivingTime = train.arrivingTimes[index.pos];
+            leg.salebeg = train.salebeg;
+            leg.saleend = train.saleend;
+            for (int k = 0; k < index.pos; ++k) {
+                leg.pos = k;
+                leg.leavingTime = train.leavingTimes[k];
+                leg.price = train.prices[index.pos] - train.prices[k];
+                TransferStation &station = transferStations[train.stations[k]];
+                int ride = leg.arrivingTime - leg.leavingTime;
+                if (station.count == 0 || ride < station.minRide) station.minRide = ride;
+                if (station.count == 0 || leg.price < station.minPrice) station.minPrice = leg.price;
+                ++station.count;
+                leg.next = station.head;
+                transferLegs.push_back(leg);
+                station.head = transferLegs.size();
+            }
+        }
+        // probe
+        TrainsData.flush(); // the workers read the mapping on a cache miss
+        for (int w = 0; w < transferPool.size(); ++w) transferWorkers[w].found = false;
+        auto probe = [&](int w, int task) {
+            probeTransfer(transferWorkers[w], indexs[task], departingDate, t, byCost);
+        };
+        if (indexs.size() >= TRANSFER_PARALLEL_MIN) {
+            transferPool.run(indexs.size(), probe);
+        } else {
+            for (int i = 0; i < indexs.size(); ++i) probe(0, i);
+        }
+        // reduce, a pair of trains is only seen by one worker so this keeps the serial order of ties
+        TransferWorker *win = nullptr;
+        for (int w = 0; w < transferPool.size(); ++w) {
+            TransferWorker &worker = transferWorkers[w];
+            count_of_transfer_evaluated += worker.evaluated;
+            count_of_transfer_pruned += worker.pruned;
+            worker.evaluated = worker.pruned = 0;
+            if (worker.found && (win == nullptr || transferBetter(worker.best, win->best, byCost))) win = &worker;
+        }
+        if (win == nullptr) return nullptr;
+        entry.found = true;
+        entry.best = win->best;
+        entry.mid = win->mid;
+        return fillTransfer(entry.best, entry.mid, _s, _t);
+    }
+
+    // the query_transfer answer for a route, with the current seat counts
+    Transfer *fillTransfer(const TransferCandidate &best, stationID_t mid, const char *_s, const char *_t) {
+        tmpTransfer.from = _s;
+        tmpTransfer.mid = Stations.name(mid);
+        tmpTransfer.to = _t;
+        tmpTransfer.trainID1 = TrainIDArray[best.trainIndex1];
+        tmpTransfer.trainID2 = TrainIDArray[best.trainIndex2];
+        tmpTransfer.leavingTime1 = best.leavingTime1;
+        tmpTransfer.arrivingTime1 = best.arrivingTime1;
+        tmpTransfer.leavingTime2 = best.leavingTime2;
+        tmpTransfer.arrivingTime2 = best.arrivingTime2;
+        tmpTransfer.price1 = best.price1;
+        tmpTransfer.price2 = best.price2;
+        datetime_t train1_dep = best.train1_dep, train2_dep = best.train2_dep;
+        tmpTransfer.seatCount1 = TrainSeats.query(best.seatIndex1, train1_dep.getDDate(), best.beg, best.mid);
+        tmpTransfer.seatCount2 = TrainSeats.query(best.seatIndex2, train2_dep.getDDate(), best.pos2, best.posT);
+        return &tmpTransfer;
+    }
+
+    // the first day (the date the train leaves its first station) on which a train leaves station pos
+    // no earlier than `time`, false if its sale ends before; as query_transfer picks the second train
+    static bool boardingDate(const Train &train, int pos, datetime_t time, datetime_t &train_dep) {
+        int startTime = train.leavingTimes[0];
+        train_dep = time - (train.leavingTimes[pos] - startTime);
+        if (train.saleend + startTime < train_dep) return false;
+        if (train_dep < train.salebeg + startTime) {
+            train_dep = train.salebeg;
+        } else {
+            if (train_dep.getTime() > startTime) train_dep = train_dep + 24 * 60;
+            train_dep.remainDate();
+        }
+        return true;
+    }
+
+    // the trainIDs of the rides, then where the rides end: the order of query_transfer among
+    // journeys of the same time and cost
+    bool routeBefore(int a, int b) {
+        int ra[ROUTE_MAX_TRANSFERS + 1], rb[ROUTE_MAX_TRANSFERS + 1];
+        int na = routeLabels[a].legs, nb = routeLabels[b].legs;
+        for (int i = na - 1, x = a; i >= 0; --i, x = routeLabels[x].parent) ra[i] = x;
+        for (int i = nb - 1, x = b; i >= 0; --i, x = routeLabels[x].parent) rb[i] = x;
+        for (int i = 0; i < na && i < nb; ++i) {
+            const trainID_t &ida = TrainIDArray[routeLabels[ra[i]].trainIndex];
+            const trainID_t &idb = TrainIDArray[routeLabels[rb[i]].trainIndex];
+            if (ida != idb) return ida < idb;
+        }
+        if (na != nb) return na < nb;
+        for (int i = 0; i < na; ++i) {
+            if (routeLabels[ra[i]].alightPos != routeLabels[rb[i]].alightPos)
+                return routeLabels[ra[i]].alightPos < routeLabels[rb[i]].alightPos;
+        }
+        return false;
+    }
+
+    // time or cost, then fewer rides, then routeBefore
+    bool routeBetter(int a, int b, bool byCost) {
+        const RouteLabel &x = routeLabels[a], &y = routeLabels[b];
+        if (byCost) {
+            if (x.cost != y.cost) return x.cost < y.cost;
+            if (x.times() != y.times()) return x.times() < y.times();
+        } else {
+            if (x.times() != y.times()) return x.times() < y.times();
+            if (x.cost != y.cost) return x.cost < y.cost;
+        }
+        if (x.legs != y.legs) return x.legs < y.legs;
+        return routeBefore(a, b);
+    }
+
+    // every continuation of b is matched by one of a at least as good, both ended on the same train:
+    // a leaves -s no earlier, arrives no later and costs no more; when that does not make a strictly
+    // better, a must also come first among ties
+    bool routeDominates(int a, int b) {
+        const RouteLabel &x = routeLabels[a], &y = routeLabels[b];
+        if (x.dep < y.dep || y.arrivingTime < x.arrivingTime || y.cost < x.cost) return false;
+        return y.dep < x.dep || x.cost < y.cost || !routeBefore(b, a);
+    }
+
+    // adds the last label to the bag of its station and train in the round, unless it is dominated
+    void routeInsert(int round) {
+        int n = routeLabels.size() - 1;
+        RouteLabel &label = routeLabels[n];
+        size_t bag = size_t(label.station) << 32 | size_t(label.trainIndex);
+        Hashmap<size_t, int, 1024> &bags = routeBags[round & 1];
+        int head = bags.count(bag) ? bags.at(bag) : -1;
+        for (int i = head; i != -1; i = routeLabels[i].nextInBag) {
+            if (routeLabels[i].alive && routeDominates(i, n)) {
+                ++count_of_route_dominated;
+                routeLabels.pop_back();
+                return;
+            }
+        }
+        for (int i = head; i != -1; i = routeLabels[i].nextInBag) {
+            if (routeLabels[i].alive && routeDominates(n, i)) {
+                ++count_of_route_dominated;
+                routeLabels[i].alive = false;
+            }
+        }
+        label.nextInBag = head;
+        bags[bag] = n;
+    }
+
+    // sorts the labels of a round (routeLabels[first ~]) left after dominance by station, then by
+    // time or cost, so that boarding a train can stop at the first label behind the best journey
+    void routeFinish(int round, int first, bool byCost) {
+        vector<int> &labels = routeRound[round & 1];
+        Hashmap<size_t, int, 1024> &stations = routeStations[round & 1];
+        labels.clear();
+        stations.clear();
+        for (int i = first; i < routeLabels.size(); ++i) {
+            if (routeLabels[i].alive) labels.push_back(i);
+        }
+        sort(labels.begin(), labels.end(), [&](int a, int b) {
+            const RouteLabel &x = routeLabels[a], &y = routeLabels[b];
+            if (x.station != y.station) return x.station < y.station;
+            return byCost ? x.cost < y.cost : x.times() < y.times();
+        });
+        for (int i = labels.size() - 1; i >= 0; --i) stations[routeLabels[labels[i]].station] = i;
+    }
+
+    // [N] query_route -s -t -d (-p time) (-k 1), -k in 1 ~ ROUTE_MAX_TRANSFERS
+    // round-based (RAPTOR): round r rides one more train from the stations reached in round r - 1,
+    // keeping per (station, train) the labels no other label dominates; journeys of 1 ~ -k transfers
+    // reaching -t are compared as query_transfer does, so -k 1 gives its answer
+    // returns -1 for a bad -k, 0 if no journey is found, 1 otherwise
+    int query_route(vector<RouteLeg> &res, const char *_s, const char *_t, const char *_d, const char *_p,
+                    const char *_k) {
+        int k = 1;
+        if (_k != nullptr) {
+            k = 0;
+            for (const char *c = _k; *c != '\0'; ++c) {
+                if (*c < '0' || *c > '9' || k > ROUTE_MAX_TRANSFERS) return -1;
+                k = k * 10 + (*c - '0');
+            }
+            if (k < 1 || k > ROUTE_MAX_TRANSFERS) return -1;
+        }
+        datetime_t departingDate = datetime_t(_d, 1) + datetime_t("23:59", 2);
+        stationID_t s = Stations.find(_s), t = Stations.find(_t);
+        if (s == -1 || t == -1) return 0;
+        bool byCost = _p != nullptr && _p[0] == 'c';
+        const StationPostingList &ls = StationLists.find(s);
+        const StationPostingList &lt = StationLists.find(t);
+        if (ls.size() == 0 || lt.size() == 0) return 0;
+        routeLabels.clear();
+        routeBags[1].clear();
+        int best = -1;
+        // round 1: the trains leaving -s on -d
+        for (size_t i = 0; i < ls.size(); ++i) {
+            TrainLite index = ls.at(i);
+            datetime_t train_dep = (departingDate - index.leavingTimes);
+            train_dep.remainDate();
+            if (!index.checkdate(train_dep)) continue;
+            const Train &train = TrainsData.get(index.trainIndex);
+            for (int j = index.pos + 1; j < train.stationNum; ++j) {
+                if (train.stations[j] == t) continue;
+                RouteLabel label;
+                label.parent = -1;
+                label.legs = 1;
+                label.trainIndex = index.trainIndex;
+                label.seatIndex = index.seatIndex;
+                label.boardPos = index.pos;
+                label.alightPos = j;
+                label.station = train.stations[j];
+                label.train_dep = train_dep;
+                label.dep = label.leavingTime = train_dep + index.leavingTimes;
+                label.arrivingTime = train_dep + train.arrivingTimes[j];
+                label.price = label.cost = train.prices[j] - index.price;
+                label.alive = true;
+                routeLabels.push_back(label);
+                ++count_of_route_label;
+                routeInsert(1);
+            }
+        }
+        routeFinish(1, 0, byCost);
+        // round r: the trains through the stations of round r - 1, only the trains through -t in the last
+        for (int r = 2; r <= k + 1; ++r) {
+            bool last = r == k + 1;
+            const vector<int> &from = routeRound[(r - 1) & 1];
+            Hashmap<size_t, int, 1024> &fromStations = routeStations[(r - 1) & 1];
+            int first = routeLabels.size();
+            routeBags[r & 1].clear();
+            routeTrains.clear();
+            vector<int> trains, seats, ends; // ends: where the scan stops, -t in the last round
+            if (last) {
+                for (size_t i = 0; i < lt.size(); ++i) {
+                    trains.push_back(lt.trainIndex[i]);
+                    seats.push_back(lt.seatIndex[i]);
+                    ends.push_back(lt.pos[i]);
                 }
-                tttt.mid = tmpTrain.stations[i];
-                indexs2.cclear();
-                auto hash_m = string_hash(tmpTrain.stations[i]);
-                StationMap.search(pair(hash_m, 0), pair(hash_m, 0x3f3f3f3f), indexs2);
-                for (auto index2 : indexs2) {
-                    TrainsData.read(tmpTrain2, index2.trainIndex);
-                    pair<int, int> stationIndex = tmpTrain2.GetStationIndex(tmpTrain.stations[i], _t);
-                    if (stationIndex.first == -1 || stationIndex.second == -1 || stationIndex.first > stationIndex.second) continue;
-                    if (tmpTrain2.trainID == tmpTrain.trainID) continue;
-                    datetime_t train2_dep = (train1_dep + tmpTrain.arrivingTimes[i] - (tmpTrain2.leavingTimes[stationIndex.first] -
-                                             tmpTrain2.leavingTimes[0]));
-                    if (tmpTrain2.endsaletime() < train2_dep) {
-                        continue;
+            } else {
+                for (size_t i = 0; i < from.size(); ++i) {
+                    stationID_t station = routeLabels[from[i]].station;
+                    if (i > 0 && routeLabels[from[i - 1]].station == station) continue;
+                    const StationPostingList &lv = StationLists.find(station);
+                    for (size_t j = 0; j < lv.size(); ++j) {
+                        if (routeTrains.count(lv.trainIndex[j])) continue;
+                        routeTrains[lv.trainIndex[j]] = 1;
+                        trains.push_back(lv.trainIndex[j]);
+                        seats.push_back(lv.seatIndex[j]);
+                        ends.push_back(maxSTATION);
                     }
-                    if (train2_dep < tmpTrain2.begsaletime()) {
-                        train2_dep = tmpTrain2.salebeg;
-                    } else {
-                        if (train2_dep.getTime() > tmpTrain2.leavingTimes[0]) {
-                            train2_dep = train2_dep + 24 * 60;
+                }
+            }
+            for (size_t y = 0; y < trains.size(); ++y) {
+                int trainIndex = trains[y], seatIndex = seats[y];
+                const Train &train = TrainsData.get(trainIndex);
+                int end = ends[y] < train.stationNum ? ends[y] : train.stationNum - 1;
+                routeBoarding.clear();
+                for (int j = 0; j <= end; ++j) {
+                    stationID_t station = train.stations[j];
+                    // alight the labels on board, the last round only alights at -t
+                    for (size_t b = 0; b < routeBoarding.size() && (!last || station == t); ++b) {
+                        const RouteBoarding boarding = routeBoarding[b];
+                        const RouteLabel &parent = routeLabels[boarding.label];
+                        RouteLabel label;
+                        label.parent = boarding.label;
+                        label.legs = r;
+                        label.trainIndex = trainIndex;
+                        label.seatIndex = seatIndex;
+                        label.boardPos = boarding.pos;
+                        label.alightPos = j;
+                        label.station = station;
+                        label.train_dep = boarding.train_dep;
+                        label.dep = parent.dep;
+                        label.leavingTime = boarding.train_dep + train.leavingTimes[boarding.pos];
+                        label.arrivingTime = boarding.train_dep + train.arrivingTimes[j];
+                        label.price = train.prices[j] - train.prices[boarding.pos];
+                        label.cost = parent.cost + label.price;
+                        label.alive = true;
+                        if (best != -1 && (byCost ? label.cost > routeLabels[best].cost :
+                                           label.times() > routeLabels[best].times())) {
+                            continue; // no ride makes it cheaper or shorter
+                        }
+                        routeLabels.push_back(label);
+                        ++count_of_route_label;
+                        if (station == t) {
+                            if (best == -1 || routeBetter(routeLabels.size() - 1, best, byCost)) best = routeLabels.size() - 1;
+                        } else {
+                            routeInsert(r);
                         }
-                        train2_dep.remainDate();
-                    }
-                    tttt.trainID2 = tmpTrain2.trainID;
-                    tttt.leavingTime2 = train2_dep + tmpTrain2.leavingTimes[stationIndex.first];
-                    tttt.arrivingTime2 = train2_dep + tmpTrain2.arrivingTimes[stationIndex.second];
-                    tttt.price2 = tmpTrain2.prices[stationIndex.second] - tmpTrain2.prices[stationIndex.first];
-                    readSeats(tmpSeats2, index2.seatIndex, train2_dep.getDDate());
-                    tttt.seatCount2 = 0x3f3f3f3f;
-                    for (int j = stationIndex.first; j < stationIndex.second; ++j) {
-                        tttt.seatCount2 = std::min(tttt.seatCount2, tmpSeats2.count[train2_dep.getDDate()][j]);
                     }
-                    if (tmpTransfer.mid.empty()) {
-                        tmpTransfer = tttt;
-                    } else {
-                        if (_p != nullptr && _p[0] == 'c') { // by cost
-                            tmpTransfer = std::min(tmpTransfer, tttt, [&](const Transfer & a, const Transfer & b) {
-                                if (a.cost() != b.cost()) return a.cost() < b.cost();
-                                if (a.times() != b.times()) return a.times() < b.times();
-                                if (a.trainID1 != b.trainID1) return a.trainID1 < b.trainID1;
-                                return a.trainID2 < b.trainID2;
-                            });
-                        } else { // by time
-                            tmpTransfer = std::min(tmpTransfer, tttt, [&](const Transfer & a, const Transfer & b) {
-                                if (a.times() != b.times()) return a.times() < b.times();
-                                if (a.cost() != b.cost()) return a.cost() < b.cost();
-                                if (a.trainID1 != b.trainID1) return a.trainID1 < b.trainID1;
-                                return a.trainID2 < b.trainID2;
-                            });
+                    if (last && station == t) break;
+                    // board the labels of the previous round at this station, up to the first one
+                    // already behind the best journey, in the last round even with the ride to -t
+                    if (!fromStations.count(station)) continue;
+                    int ride = last ? train.arrivingTimes[end] - train.leavingTimes[j] : 0;
+                    int price = last ? train.prices[end] - train.prices[j] : 0;
+                    for (int i = fromStations.at(station); i < from.size(); ++i) {
+                        const RouteLabel &label = routeLabels[from[i]];
+                        if (label.station != station) break;
+                        if (best != -1 && (byCost ? label.cost + price > routeLabels[best].cost :
+                                           label.times() + ride > routeLabels[best].times())) {
+                            break;
                         }
+                        if (label.trainIndex == trainIndex) continue;
+                        RouteBoarding boarding;
+                        if (!boardingDate(train, j, label.arrivingTime, boarding.train_dep)) continue;
+                        boarding.label = from[i];
+                        boarding.pos = j;
+                        routeBoarding.push_back(boarding);
                     }
                 }
             }
+            if (!last) routeFinish(r, first, byCost);
         }
-        if (tmpTransfer.mid.empty()) return nullptr;
-        return &tmpTransfer;
+        if (best == -1) return 0;
+        int legs = routeLabels[best].legs;
+        res.resize(legs);
+        for (int i = legs - 1, x = best; i >= 0; --i, x = routeLabels[x].parent) {
+            const RouteLabel &label = routeLabels[x];
+            RouteLeg &leg = res[i];
+            leg.trainID = TrainIDArray[label.trainIndex];
+            leg.from = label.parent == -1 ? s : routeLabels[label.parent].station;
+            leg.to = label.station;
+            leg.leavingTime = label.leavingTime;
+            leg.arrivingTime = label.arrivingTime;
+            leg.price = label.price;
+            datetime_t train_dep = label.train_dep;
+            leg.seatCount = TrainSeats.query(label.seatIndex, train_dep.getDDate(), label.boardPos, label.alightPos);
+        }
+        return 1;
     }
 
 
@@ -297,43 +890,38 @@ class TrainSystem {
             CERR("train %s not released\n", _i);
             return {nullptr, 0};
         }
-        TrainsData.read(tmpTrain, tmp.first.trainIndex);
-        if (tmpTrain.seatNum < atoi(_n)) {
+        const Train &train = TrainsData.get(tmp.first.trainIndex);
+        if (train.seatNum < atoi(_n)) {
             CERR("train %s Not enough seatsc (ps: seatNum < Num)\n", _i);
             return {nullptr, 0};
         }
-        pair<int, int> stationIndex = tmpTrain.GetStationIndex(_f, _t);
+        pair<int, int> stationIndex = train.GetStationIndex(Stations.find(_f), Stations.find(_t));
         if (stationIndex.first == -1 || stationIndex.second == -1 || stationIndex.first > stationIndex.second) {
             CERR("train %s stationErr\n", _i);
             return {nullptr, 0};
         }
-        datetime_t train_dep = (datetime_t(_d, 1) + datetime_t("23:59", 2) - tmpTrain.leavingTimes[stationIndex.first]);
+        datetime_t train_dep = (datetime_t(_d, 1) + datetime_t("23:59", 2) - train.leavingTimes[stationIndex.first]);
         train_dep.remainDate();
-        if (!tmpTrain.checkdate(train_dep)) {
+        if (!train.checkdate(train_dep)) {
             CERR("train %s OutofDate\n", _i);
             return {nullptr, 0};
         }
         tmpOrder.trainID = _i;
         tmpOrder.date = train_dep;
-        tmpOrder.from = _f;
-        tmpOrder.to = _t;
+        tmpOrder.from = train.stations[stationIndex.first];
+        tmpOrder.to = train.stations[stationIndex.second];
         tmpOrder.num = atoi(_n);
-        tmpOrder.price = tmpTrain.prices[stationIndex.second] - tmpTrain.prices[stationIndex.first];
+        tmpOrder.price = train.prices[stationIndex.second] - train.prices[stationIndex.first];
         tmpOrder.state = 0;
         tmpOrder.user = _u;
-        tmpOrder.leavingTime = tmpTrain.leavingTimes[stationIndex.first];
-        tmpOrder.arrivingTime = tmpTrain.arrivingTimes[stationIndex.second];
-        readSeats(tmpSeats, tmp.first.seatIndex, train_dep.getDDate());
-        int seatCount = 0x3f3f3f3f;
-        for (int i = stationIndex.first; i < stationIndex.second; ++i) {
-            seatCount = std::min(seatCount, tmpSeats.count[train_dep.getDDate()][i]);
-        }
+        tmpOrder.leavingTime = train.leavingTimes[stationIndex.first];
+        tmpOrder.arrivingTime = train.arrivingTimes[stationIndex.second];
+        int seatCount = TrainSeats.query(tmp.first.seatIndex, train_dep.getDDate(), stationIndex.first,
+                                         stationIndex.second);
         if (seatCount >= tmpOrder.num) {
             tmpOrder.state = 1;
-            for (int i = stationIndex.first; i < stationIndex.second; ++i) {
-                tmpSeats.count[train_dep.getDDate()][i] -= tmpOrder.num;
-            }
-            writeSeats(tmpSeats, tmp.first.seatIndex, train_dep.getDDate());
+            TrainSeats.add(tmp.first.seatIndex, train_dep.getDDate(), stationIndex.first, stationIndex.second,
+                           -tmpOrder.num);
         } else { // not enough seats
             if (_q == nullptr || _q[0] == 'f') {
                 CERR("train %s Not enough seats And user don't queue\n", _i);
@@ -342,11 +930,16 @@ class TrainSystem {
         }
         int orderIndex = OrdersData.write(tmpOrder);
         if (tmpOrder.isPending()) {
-            TrainUnitMap.insert(pair(TrainUnit{tmp.first.trainIndex, train_dep}, orderIndex), orderIndex);
+            PendingOrders.push(tmp.first.trainIndex, train_dep.getDDate(),
+                               PendingOrder{orderIndex, stationIndex.first, stationIndex.second, tmpOrder.num});
         }
         return {&tmpOrder, orderIndex};
     }
 
+    const stationName_t &stationName(stationID_t id) const {
+        return Stations.name(id);
+    }
+
     void query_order(vector<Order> &res, vector<int> index) {
         for (auto i : index) {
             OrdersData.read(tmpOrder, i);
@@ -362,44 +955,31 @@ class TrainSystem {
             CERR("Order has been refunded\n");
             return 0;
         } else if (tmpOrder.isPending()) {
-            TrainUnitMap.remove(pair(TrainUnit{tmp.trainIndex, tmpOrder.date}, orderIndex));
+            PendingOrders.remove(tmp.trainIndex, tmpOrder.date.getDDate(), orderIndex);
             tmpOrder.state = 2;
             OrdersData.update(tmpOrder, orderIndex);
         } else {
-            TrainsData.read(tmpTrain, tmp.trainIndex);
-            pair<int, int> stationIndex = tmpTrain.GetStationIndex(tmpOrder.from, tmpOrder.to);
+            const Train &train = TrainsData.get(tmp.trainIndex);
+            pair<int, int> stationIndex = train.GetStationIndex(tmpOrder.from, tmpOrder.to);
             datetime_t train_dep = tmpOrder.date;
-            readSeats(tmpSeats, tmp.seatIndex, train_dep.getDDate());
-            for (int i = stationIndex.first; i < stationIndex.second; ++i) {
-                tmpSeats.count[train_dep.getDDate()][i] += tmpOrder.num;
-            }
+            TrainSeats.row(tmp.seatIndex, train_dep.getDDate()).add(stationIndex.first, stationIndex.second,
+                                                                    tmpOrder.num);
             tmpOrder.state = 2;
             OrdersData.update(tmpOrder, orderIndex);
-            // check if there are any pending orders
-            vector<int> indexs;
-            TrainUnitMap.search(pair(TrainUnit{tmp.trainIndex, train_dep}, 0), pair(TrainUnit{tmp.trainIndex, train_dep},
-                                0x3f3f3f3f), indexs);
-            for (auto idx : indexs) {
-                OrdersData.read(tmpOrder, idx);
-                if (tmpOrder.isPending()) {
-                    stationIndex = tmpTrain.GetStationIndex(tmpOrder.from, tmpOrder.to);
-                    int seatCount = 0x3f3f3f3f;
-                    for (int i = stationIndex.first; i < stationIndex.second; ++i) {
-                        seatCount = std::min(seatCount, tmpSeats.count[train_dep.getDDate()][i]);
-                    }
-                    if (seatCount < tmpOrder.num) continue;
-                    for (int i = stationIndex.first; i < stationIndex.second; ++i) {
-                        tmpSeats.count[train_dep.getDDate()][i] -= tmpOrder.num;
-                    }
-                    tmpOrder.state = 1;
-                    OrdersData.update(tmpOrder, idx);
-                    TrainUnitMap.remove(pair(TrainUnit{tmp.trainIndex, train_dep}, idx));
-                } else {
-                    CERR("WTF? Order in queue is not pending?\n");
-                    throw;
+            // check if there are any pending orders; every one of them was short of seats before this
+            // refund, so only the ones sharing a segment with the freed interval can be promoted
+            SeatRow &row = TrainSeats.row(tmp.seatIndex, train_dep.getDDate());
+            PendingOrders.promote(tmp.trainIndex, train_dep.getDDate(), [&](const PendingOrder & p) {
+                if (p.to <= stationIndex.first || stationIndex.second <= p.from || row.min(p.from, p.to) < p.num) {
+                    return false;
                 }
-            }
-            writeSeats(tmpSeats, tmp.seatIndex, train_dep.getDDate());
+                row.add(p.from, p.to, -p.num);
+                OrdersData.read(tmpOrder, p.orderIndex);
+                tmpOrder.state = 1;
+                OrdersData.update(tmpOrder, p.orderIndex);
+                return true;
+            });
+            TrainSeats.update(tmp.seatIndex, train_dep.getDDate());
         }
         return 1;
     }
@@ -30,8 +30,8 @@ struct User {
 struct Order {
     username_t user;
     trainID_t trainID;
-    stationName_t from;
-    stationName_t to;
+    stationID_t from;
+    stationID_t to;
     datetime_t date;
     int leavingTime;
     int arrivingTime;
@@ -6,18 +6,24 @@
 #include "utils.hpp"
 #include "User.hpp"
 #include "BPlusTree.hpp"
+#include "HashIndex.hpp"
 #include "Hashmap.hpp"
 #include "File.hpp"
 #include <cstddef>
 
+// message buffer of each inner node of UserOrders, see BPlusTree (0: a plain B+ tree)
+#ifndef USER_ORDERS_BUFFER
+#define USER_ORDERS_BUFFER 176
+#endif
+
 namespace sjtu {
 
 struct Empty {};
 
 class UserSystem {
-    HashMapFile<size_t, User, 20023> Users;
+    HashIndex<size_t, User, 4096, 1000> Users; // username_hash -> User
     Hashmap<size_t, Empty, 20023> loginUsers;
-    BPlusTree<pair<size_t, int>, int, 4096, 200000> UserOrders;
+    BPlusTree<pair<size_t, int>, int, 4096, 200000, true, USER_ORDERS_BUFFER> UserOrders;
 
     User tmpUser;
 
@@ -40,13 +46,13 @@ class UserSystem {
         if (Users.empty()) [[unlikely]] {
             // first user
             tmpUser.priv = 10;
-            Users.insert({hash_u, tmpUser});
+            Users.insert(hash_u, tmpUser);
             return 1;
         } else {
             if (Users.count(hash_u)) return 0;
             if (loginUsers.count(hash_c) == 0) return 0;
-            if (Users[hash_c].priv <= tmpUser.priv) return 0;
-            Users.insert({hash_u, tmpUser});
+            if (Users.find(hash_c).first.priv <= tmpUser.priv) return 0;
+            Users.insert(hash_u, tmpUser);
             return 1;
         }
     }
@@ -55,8 +61,9 @@ class UserSystem {
     bool login(const char *_u, const char *_p) {
         size_t hash_u = string_hash(_u);
         if (loginUsers.count(hash_u)) return 0;
-        if (Users.count(hash_u) == false) return 0;
-        if (Users[hash_u].pass != _p) return 0;
+        auto tmpu = Users.find(hash_u);
+        if (tmpu.second == false) return 0;
+        if (tmpu.first.pass != _p) return 0;
         loginUsers.insert(pair(hash_u, Empty()));
         return 1;
     }
@@ -77,12 +84,13 @@ class UserSystem {
             CERR("user %s not login\n", _c);
             return nullptr;
         }
-        if (Users.count(hash_u) == false) {
+        auto tmpu = Users.find(hash_u);
+        if (tmpu.second == false) {
             CERR("user %s not exist\n", _u);
             return nullptr;
         }
-        tmpUser = Users[hash_u];
-        auto tmpc = Users[hash_c];
+        tmpUser = tmpu.first;
+        auto tmpc = Users.find(hash_c).first;
         if (tmpc.priv < tmpUser.priv || (tmpc.priv == tmpUser.priv && tmpc.user != tmpUser.user)) {
             CERR("user %s has no privilege to query user %s\n", _c, _u);
             return nullptr;
@@ -95,9 +103,10 @@ class UserSystem {
         size_t hash_c = string_hash(_c);
         size_t hash_u = string_hash(_u);
         if (loginUsers.count(hash_c) == 0) return nullptr;
-        if (Users.count(hash_u) == 0) return nullptr;
-        tmpUser = Users[hash_u];
-        auto tmpc = Users[hash_c];
+        auto tmpu = Users.find(hash_u);
+        if (tmpu.second == false) return nullptr;
+        tmpUser = tmpu.first;
+        auto tmpc = Users.find(hash_c).first;
         if (tmpc.priv < tmpUser.priv || (tmpc.priv == tmpUser.priv && tmpc.user != tmpUser.user)) {
             CERR("user %s has no privilege to query user %s\n", _c, _u);
             return nullptr;
@@ -110,7 +119,7 @@ class UserSystem {
             CERR("-g can't be greater than or equal to %d\n", tmpc.priv);
             return nullptr;
         }
-        Users[hash_u] = tmpUser;
+        Users.modify(hash_u, tmpUser);
         return &tmpUser;
     }
 
@@ -0,0 +1,123 @@
+#ifndef _WAITLIST_HPP_
+#define _WAITLIST_HPP_
+
+#include "Vector.hpp"
+#include "Hashmap.hpp"
+#include "utils.hpp"
+#include <fstream>
+#include <string>
+
+namespace sjtu {
+
+// a pending order of one train on one day, with its segments [from, to)
+struct PendingOrder {
+    int orderIndex;
+    int from, to;
+    int num;
+};
+
+// the pending orders of every (trainIndex, day) in order of orderIndex, kept in memory and
+// saved to <name>.dat on exit
+class Waitlist {
+    std::string file_name;
+    Hashmap<size_t, int, 1024> index; // (trainIndex, day) -> queues
+    vector<size_t> keys;
+    vector<vector<PendingOrder> *> queues;
+    size_t m_size = 0; // pending orders of all queues
+
+    static size_t key(int trainIndex, int day) {
+        return size_t(trainIndex) * maxDURATION + day;
+    }
+
+    vector<PendingOrder> &get(size_t k) {
+        if (!index.count(k)) {
+            index[k] = queues.size();
+            keys.push_back(k);
+            queues.push_back(new vector<PendingOrder>);
+        }
+        return *queues[index.at(k)];
+    }
+
+  public:
+    Waitlist(const std::string &name) : file_name(name + ".dat") {
+        std::ifstream file(file_name, std::ios::binary);
+        if (!file.good()) return;
+        size_t count = 0;
+        file.read(reinterpret_cast<char *>(&count), sizeof(size_t));
+        for (size_t i = 0; i < count && file.good(); ++i) {
+            size_t k, n;
+            file.read(reinterpret_cast<char *>(&k), sizeof(size_t));
+            file.read(reinterpret_cast<char *>(&n), sizeof(size_t));
+            vector<PendingOrder> &queue = get(k);
+            queue.resize(n);
+            file.read(reinterpret_cast<char *>(queue.data()), n * sizeof(PendingOrder));
+            m_size += n;
+        }
+    }
+
+    ~Waitlist() {
+        std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+        size_t count = 0;
+        for (size_t i = 0; i < queues.size(); ++i) count += !queues[i]->empty();
+        file.write(reinterpret_cast<const char *>(&count), sizeof(size_t));
+        for (size_t i = 0; i < queues.size(); ++i) {
+            const vector<PendingOrder> &queue = *queues[i];
+            size_t n = queue.size();
+            if (n) {
+                file.write(reinterpret_cast<const char *>(&keys[i]), sizeof(size_t));
+                file.write(reinterpret_cast<const char *>(&n), sizeof(size_t));
+                file.write(reinterpret_cast<const char *>(queue.data()), n * sizeof(PendingOrder));
+            }
+            delete queues[i];
+        }
+    }
+
+    Waitlist(const Waitlist &) = delete;
+    Waitlist &operator=(const Waitlist &) = delete;
+
+    // orderIndex grows with every order, so the queue stays in order
+    void push(int trainIndex, int day, const PendingOrder &order) {
+        get(key(trainIndex, day)).push_back(order);
+        ++m_size;
+    }
+
+    bool remove(int trainIndex, int day, int orderIndex) {
+        size_t k = key(trainIndex, day);
+        if (!index.count(k)) return false;
+        vector<PendingOrder> &queue = *queues[index.at(k)];
+        for (size_t i = 0; i < queue.size(); ++i) {
+            if (queue[i].orderIndex == orderIndex) {
+                queue.erase(i);
+                --m_size;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // walks the pending orders of a train on a day in order, drops every one for which pred(order)
+    // returns true (the caller promoted it) and keeps the others in order; returns the number dropped
+    template <class F>
+    size_t promote(int trainIndex, int day, F pred) {
+        size_t k = key(trainIndex, day);
+        if (!index.count(k)) return 0;
+        vector<PendingOrder> &queue = *queues[index.at(k)];
+        size_t kept = 0;
+        for (size_t i = 0; i < queue.size(); ++i) {
+            const PendingOrder order = queue[i];
+            if (!pred(order)) queue[kept++] = order;
+        }
+        size_t dropped = queue.size() - kept;
+        queue.resize(kept);
+        m_size -= dropped;
+        return dropped;
+    }
+
+    size_t size() const {
+        return m_size;
+    }
+};
+
+} // namespace sjtu
+
+#endif // _WAITLIST_HPP_
@@ -30,6 +30,7 @@ const int maxSTATION = 100;
 const int maxDURATION = 92; // 6-1 ~ 8-31
 typedef String<21> trainID_t;
 typedef String<31> stationName_t;
+typedef int stationID_t; // dense id of a station name, see StationDict
 typedef int number_t; // use for stationNum / seatNum
 typedef int price_t;
 typedef short mytime_t;
@@ -78,11 +79,11 @@ struct datetime_t {
     }
 
     // From 06-01
-    int getDDate() {
+    int getDDate() const {
         return value / (24 * 60) - 152;
     }
 
-    int getTime() {
+    int getTime() const {
         return value % (24 * 60);
     }
 
@@ -151,6 +152,8 @@ enum class CMD {
     MP, // modify_profile,
     QI, // query_ticket,
     QR, // query_transfer,
+    RO, // query_route,
+    QB, // query_board,
     BT, // buy_ticket,
     QO, // query_order,
     RI, // refund_ticket,
@@ -217,6 +220,8 @@ class command_helper {
         if (strcmp(buf, "modify_profile") == 0) return CMD::MP;
         if (strcmp(buf, "query_ticket") == 0) return CMD::QI;
         if (strcmp(buf, "query_transfer") == 0) return CMD::QR;
+        if (strcmp(buf, "query_route") == 0) return CMD::RO;
+        if (strcmp(buf, "query_board") == 0) return CMD::QB;
         if (strcmp(buf, "buy_ticket") == 0) return CMD::BT;
         if (strcmp(buf, "query_order") == 0) return CMD::QO;
         if (strcmp(buf, "refund_ticket") == 0) return CMD::RI;